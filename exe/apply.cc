@@ -0,0 +1,75 @@
+#include "apply.hpp"
+
+#include <libral/manifest.hpp>
+#include <libral/parallel.hpp>
+
+#include <boost/nowide/iostream.hpp>
+#include <leatherman/locale/locale.hpp>
+
+#include <fstream>
+#include <sstream>
+
+using namespace leatherman::locale;
+namespace lib = libral;
+
+namespace apply {
+
+  // Same as in ralsh.cc
+  const static int EXIT_ERROR = 2;
+
+  static lib::result<std::string> read_manifest(const std::string& path) {
+    std::ostringstream text;
+    if (path == "-") {
+      text << boost::nowide::cin.rdbuf();
+    } else {
+      std::ifstream in(path);
+      if (! in) {
+        return lib::error(_("can not open {1}", path));
+      }
+      text << in.rdbuf();
+    }
+    return text.str();
+  }
+
+  int run(lib::ral& ral, const std::string& path, unsigned int jobs,
+          const lib::limits& lim, lib::emitter& em) {
+    auto text = read_manifest(path);
+    if (! text) {
+      boost::nowide::cerr << _("error: {1}", text.err().detail)
+                          << std::endl;
+      return EXIT_ERROR;
+    }
+
+    auto mf = lib::manifest::parse(text.ok(), ral.providers());
+    if (! mf) {
+      boost::nowide::cerr << _("error: {1}", mf.err().detail)
+                          << std::endl;
+      return EXIT_ERROR;
+    }
+    auto& entries = mf.ok().entries();
+    auto lanes = mf.ok().lanes();
+
+    // Providers that share files, or whose resources depend on each
+    // other's, like users on their groups, are in the same lane and
+    // change their resources one after the other; different lanes run
+    // concurrently. Within one provider, the provider's set action decides
+    // in what order resources change
+    lib::emitter::sets sts;
+    for (const auto& e : entries) {
+      sts.emplace_back(e.first, lib::emitter::set_result());
+    }
+    lib::parallel_for(lanes.size(), jobs,
+                      [&lanes, &entries, &sts, &lim](size_t i) {
+        for (auto j : lanes[i]) {
+          sts[j].second = entries[j].first->set(entries[j].second, lim);
+        }
+      });
+
+    em.print_sets(sts);
+    for (const auto& s : sts) {
+      if (! s.second)
+        return EXIT_ERROR;
+    }
+    return EXIT_SUCCESS;
+  }
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string>
+
+#include <libral/ral.hpp>
+#include <libral/emitter/emitter.hpp>
+
+/* Support for 'ralsh --apply'. A manifest lists the desired state of many
+ * resources, possibly of different types; see doc/ralsh-apply.md for its
+ * format. */
+namespace apply {
+
+  /**
+   * Reads a manifest from the file \p path, or from stdin if \p path is
+   * '-', and makes the resources in it look the way the manifest says.
+   *
+   * All resources for the same provider are changed with one call to that
+   * provider's set action. Providers that must not run at the same time
+   * run one after the other in the order manifest::lanes() gives; the
+   * set actions of up to \p jobs other providers run concurrently,
+   * subject to \p lim. Nothing is changed if the
+   * manifest can not be read in its entirety. The outcome for all
+   * providers is printed with \p em. Returns the exit status for ralsh.
+   */
+  int run(libral::ral& ral, const std::string& path, unsigned int jobs,
+          const libral::limits& lim, libral::emitter& em);
+}
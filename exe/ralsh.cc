@@ -4,17 +4,33 @@
 #include <boost/filesystem.hpp>
 #include <leatherman/logging/logging.hpp>
 #include <leatherman/util/environment.hpp>
+#include <leatherman/json_container/json_container.hpp>
 
 #include <libral/emitter/puppet_emitter.hpp>
 #include <libral/emitter/json_emitter.hpp>
 #include <libral/emitter/quiet_emitter.hpp>
+#include <libral/trace.hpp>
+#include <libral/parallel.hpp>
+#include <libral/snapshot.hpp>
 
 #include <stdint.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
 
+#include <algorithm>
 #include <iomanip>
+#include <fstream>
+#include <thread>
+
+#include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/classification.hpp>
 
 #include <config.hpp>
 
+#include "rpc.hpp"
+#include "apply.hpp"
+
 // boost includes are not always warning-clean. Disable warnings that
 // cause problems before including the headers, then re-enable the warnings.
 #pragma GCC diagnostic push
@@ -66,12 +82,67 @@ Print resources managed by libral and modify them.
 The positional arguments make ralsh behave in the following way:
   ralsh           : list all the types that libral knows about.
   ralsh TYPE      : list all instances of TYPE
+  ralsh TYPE1,TYPE2,... :
+                    list all instances of several types at once
+  ralsh --all     : list all instances of all types
   ralsh TYPE NAME : list just TYPE[NAME]
   ralsh TYPE NAME ATTRIBUTE=VALUE ... :
                     modify TYPE[NAME] by setting the provided attributes
                     to the corresponding values. Print the resulting resource
                     and a list of the changes that were made.
 
+When ralsh lists several types, it asks their providers for their
+instances concurrently, running at most as many providers at once as
+--jobs says, and prints everything as one document; with --json, that
+document has a 'resources' list and an 'errors' list for the providers
+that failed. The file type can not list all its instances and is left out
+by --all.
+
+With --attrs ATTR1,ATTR2,... ralsh only prints those attributes of the
+resources it lists, besides their name and ensure. Providers can use that
+to skip computing expensive attributes, like the groups of a user or the
+checksum of a file.
+
+With --filter EXPR, ralsh only lists the resources that match EXPR, which
+compares an attribute with a value: 'ensure=running' and 'shell!=/bin/false'
+check equality, 'uid>=1000' (and <, <=, >) compares numbers or strings, and
+'name~sys*' matches a shell glob. When --filter is given several times,
+resources have to match all of them. Filtering on an attribute that a type
+does not have is an error; when listing several types, those types are
+left out.
+
+With --apply FILE, ralsh reads the desired state of many resources, of any
+number of types, from the JSON manifest FILE, or from stdin if FILE is '-',
+and changes all of them in one run. The resources of each provider are
+changed together, and different providers do their work concurrently,
+except that groups come before users, packages before services, and
+providers that change the same files run one after the other.
+
+With --snapshot FILE, ralsh writes the state of the types given as for
+listing several types, or with --all, to the snapshot file FILE. Running
+ralsh with --diff FILE later prints the resources that were added, removed
+or changed since then, together with their changed attributes; with
+--diff OLD --diff NEW, it compares two snapshots instead. ralsh exits with
+status 1 when there are differences.
+
+With --watch, ralsh prints how the resources of the types given as for
+listing several types, or with --all, change whenever the files they are
+stored in change, in the same format as --diff, until it is interrupted.
+With --watch TYPE NAME, it only watches TYPE[NAME]. Only the builtin
+providers can be watched, and only on the local system.
+
+With --daemon SOCKET, ralsh discovers providers once and then serves
+requests on the Unix domain socket SOCKET until it is interrupted. Running
+ralsh with --connect SOCKET and any of the positional arguments above sends
+the request to that daemon instead, and always produces JSON output.
+
+With --profile, ralsh prints how often discovering providers, running
+provider actions and commands, copying files to and from the target and
+loading and saving files with Augeas happened, and how long each took.
+--trace FILE writes the same information as a Chrome trace, which can be
+viewed in chrome://tracing or https://ui.perfetto.dev. Neither works with
+--daemon or --watch, since they only report when ralsh exits.
+
 Options:
 )txt";
   const static std::string help2 =
@@ -130,6 +201,334 @@ static void print_explanation(lib::provider& prov) {
   }
 }
 
+/* Look up the provider for each of types, or all providers if all is
+ * true, amongst provs and add them to lsts */
+static bool select_providers(const std::vector<std::shared_ptr<lib::provider>>& provs,
+                             const std::vector<std::string>& types,
+                             bool all, lib::emitter::lists& lsts) {
+  if (all) {
+    for (const auto& p : provs) {
+      if (p->type_name() != "file") {
+        lsts.emplace_back(p, lib::emitter::list_result());
+      }
+    }
+    return true;
+  }
+
+  for (const auto& type_name : types) {
+    auto opt_prov = lib::ral::find_provider(type_name, provs);
+    if (opt_prov == boost::none) {
+      boost::nowide::cout << color::red
+                          << _("unknown provider: '{1}'", type_name)
+                          << color::reset << endl;
+      boost::nowide::cout << _("run 'ralsh' to see a list of all providers")
+                          << color::reset << endl;
+      return false;
+    }
+    lsts.emplace_back(*opt_prov, lib::emitter::list_result());
+  }
+  return true;
+}
+
+/* The attributes in attrs that prov has. Since asking for no attributes
+ * means asking for all of them, that is just the name if prov has none of
+ * them */
+static std::vector<std::string>
+known_attrs(const lib::provider& prov, const std::vector<std::string>& attrs) {
+  if (attrs.empty()) {
+    return attrs;
+  }
+  std::vector<std::string> known;
+  for (const auto& a : attrs) {
+    if (prov.spec()->attr(a)) {
+      known.push_back(a);
+    }
+  }
+  if (known.empty()) {
+    known.push_back("name");
+  }
+  return known;
+}
+
+/* Get all instances for each provider in lsts. The get actions run
+ * concurrently, on a pool of at most jobs threads. Each provider is only
+ * asked for those of attrs that it has */
+static void get_all(lib::emitter::lists& lsts, unsigned int jobs,
+                    const lib::limits& lim,
+                    const std::vector<std::string>& attrs = { },
+                    const lib::filter& filt = lib::filter()) {
+  lib::parallel_for(lsts.size(), jobs, [&lsts, &lim, &attrs, &filt](size_t i) {
+      auto& prov = *lsts[i].first;
+      lsts[i].second = prov.get({ }, lim, known_attrs(prov, attrs), filt);
+    });
+}
+
+/* Print the errors of the providers in lsts whose get action failed, and
+ * return true if there were any */
+static bool print_get_errors(const lib::emitter::lists& lsts) {
+  bool failed = false;
+  for (const auto& l : lsts) {
+    if (! l.second) {
+      boost::nowide::cerr << color::red
+                          << _("{1} failed: {2}", l.first->qname(),
+                               l.second.err().detail)
+                          << color::reset << endl;
+      failed = true;
+    }
+  }
+  return failed;
+}
+
+/* List the instances of several providers at once and print the results
+ * as one document */
+static int list_many(lib::ral& ral, const std::vector<std::string>& types,
+                     bool all, unsigned int jobs, const lib::limits& lim,
+                     const std::vector<std::string>& attrs,
+                     const lib::filter& filt, lib::emitter& em) {
+  lib::emitter::lists lsts;
+  if (! select_providers(ral.providers(), types, all, lsts)) {
+    return EXIT_ERROR;
+  }
+
+  // Different types have different attributes, but each attribute has
+  // to belong to at least one of them
+  for (const auto& a : attrs) {
+    auto known = std::any_of(lsts.begin(), lsts.end(),
+                             [&a](const lib::emitter::lists::value_type& l) {
+                               return l.first->spec()->attr(a) != boost::none;
+                             });
+    if (! known) {
+      boost::nowide::cerr << color::red
+                          << _("none of the types has an attribute {1}", a)
+                          << color::reset << endl;
+      return EXIT_ERROR;
+    }
+  }
+
+  // The same goes for the attributes of the filter; types that do not
+  // have all of them are left out, since providers reject such filters
+  for (const auto& pred : filt.predicates()) {
+    auto has_attr = [&pred](const lib::emitter::lists::value_type& l) {
+      return pred.attr == "name"
+        || l.first->spec()->attr(pred.attr) != boost::none;
+    };
+    if (std::none_of(lsts.begin(), lsts.end(), has_attr)) {
+      boost::nowide::cerr << color::red
+                          << _("none of the types has an attribute {1}",
+                               pred.attr)
+                          << color::reset << endl;
+      return EXIT_ERROR;
+    }
+    lsts.erase(std::remove_if(lsts.begin(), lsts.end(),
+                              [&has_attr](const lib::emitter::lists::value_type& l) {
+                                return ! has_attr(l);
+                              }), lsts.end());
+  }
+
+  get_all(lsts, jobs, lim, attrs, filt);
+
+  em.print_lists(lsts);
+  for (const auto& l : lsts) {
+    if (! l.second)
+      return EXIT_ERROR;
+  }
+  return EXIT_SUCCESS;
+}
+
+/* Write the state of the providers for types, or of all providers, to
+ * the snapshot file path */
+static int write_snapshot(lib::ral& ral, const std::string& path,
+                          const std::vector<std::string>& types,
+                          bool all, unsigned int jobs,
+                          const lib::limits& lim) {
+  lib::emitter::lists lsts;
+  if (! select_providers(ral.providers(), types, all, lsts)) {
+    return EXIT_ERROR;
+  }
+
+  get_all(lsts, jobs, lim);
+  // A snapshot that silently lacks a provider would show up as all its
+  // resources having been removed in later diffs
+  if (print_get_errors(lsts)) {
+    return EXIT_ERROR;
+  }
+
+  lib::snapshot::builder bld;
+  for (const auto& l : lsts) {
+    bld.add(*l.first, l.second.ok());
+  }
+  auto res = bld.write(path);
+  if (! res) {
+    boost::nowide::cerr << color::red << res.err().detail
+                        << color::reset << endl;
+    return EXIT_ERROR;
+  }
+  return EXIT_SUCCESS;
+}
+
+/* Compare the snapshots in paths, or, if there is only one, the current
+ * state of the providers in it against it, and print the differences.
+ * Like diff(1), exits with EXIT_FAILURE if there are any */
+static int diff_snapshots(lib::ral& ral,
+                          const std::vector<std::string>& paths,
+                          unsigned int jobs, const lib::limits& lim,
+                          lib::emitter& em) {
+  auto from = lib::snapshot::open(paths[0]);
+  if (! from) {
+    boost::nowide::cerr << color::red << from.err().detail
+                        << color::reset << endl;
+    return EXIT_ERROR;
+  }
+
+  lib::snapshot::uptr to;
+  if (paths.size() > 1) {
+    auto snap = lib::snapshot::open(paths[1]);
+    if (! snap) {
+      boost::nowide::cerr << color::red << snap.err().detail
+                          << color::reset << endl;
+      return EXIT_ERROR;
+    }
+    to = std::move(snap.ok());
+  } else {
+    lib::emitter::lists lsts;
+    if (! select_providers(ral.providers(), from.ok()->providers(),
+                           false, lsts)) {
+      return EXIT_ERROR;
+    }
+    get_all(lsts, jobs, lim);
+    if (print_get_errors(lsts)) {
+      return EXIT_ERROR;
+    }
+
+    lib::snapshot::builder bld;
+    for (const auto& l : lsts) {
+      bld.add(*l.first, l.second.ok());
+    }
+    to = bld.build();
+  }
+
+  auto diffs = lib::snapshot::diff(*from.ok(), *to);
+  em.print_diff(diffs);
+  return diffs.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* Print the changes to the resources of the providers for types, or of
+ * all providers that can be watched, as they happen. If name is not
+ * empty, only watch that resource of the one type. Runs until ralsh is
+ * interrupted */
+static int watch(lib::ral& ral, const std::vector<std::string>& types,
+                 bool all, const std::string& name, const lib::limits& lim,
+                 lib::emitter& em) {
+  auto wres = ral.watch();
+  if (! wres) {
+    boost::nowide::cerr << color::red << wres.err().detail
+                        << color::reset << endl;
+    return EXIT_ERROR;
+  }
+  auto& watcher = *wres.ok();
+
+  lib::emitter::lists lsts;
+  if (! select_providers(ral.providers(), types, all, lsts)) {
+    return EXIT_ERROR;
+  }
+  std::vector<std::string> names;
+  if (! name.empty()) {
+    names.push_back(name);
+  }
+  for (const auto& l : lsts) {
+    if (all && l.first->watch_paths({ }).empty()) {
+      continue;
+    }
+    auto res = watcher.add(l.first, names, lim);
+    if (! res) {
+      boost::nowide::cerr << color::red << res.err().detail
+                          << color::reset << endl;
+      return EXIT_ERROR;
+    }
+  }
+
+  auto res = watcher.run([&em](const lib::provider& prov,
+                               const lib::result<std::vector<lib::snapshot::difference>>& deltas) {
+      if (! deltas) {
+        boost::nowide::cerr << color::red
+                            << _("{1} failed: {2}", prov.qname(),
+                                 deltas.err().detail)
+                            << color::reset << endl;
+      } else {
+        em.print_diff(deltas.ok());
+      }
+      return true;
+    });
+  if (! res) {
+    boost::nowide::cerr << color::red << res.err().detail
+                        << color::reset << endl;
+    return EXIT_ERROR;
+  }
+  return EXIT_SUCCESS;
+}
+
+/* Turn the positional arguments into a request for 'ralsh --daemon' */
+static std::string make_request(const po::variables_map& vm) {
+  leatherman::json_container::JsonContainer js;
+
+  std::string action = "get";
+  if (vm.count("explain") || ! vm.count("type")) {
+    action = "describe";
+  } else if (vm.count("name") && vm.count("attr-value")) {
+    action = "set";
+  }
+  js.set<std::string>("action", action);
+
+  if (vm.count("type"))
+    js.set<std::string>("type", vm["type"].as<std::string>());
+  if (vm.count("name"))
+    js.set<std::string>("name", vm["name"].as<std::string>());
+  if (vm.count("absent"))
+    js.set<bool>("absent", true);
+  if (vm.count("timeout"))
+    js.set<int>("timeout", static_cast<int>(vm["timeout"].as<unsigned int>()));
+
+  if (action == "set") {
+    for (const auto& arg : vm["attr-value"].as<std::vector<std::string>>()) {
+      auto found = arg.find("=");
+      if (found != string::npos) {
+        js.set<std::string>({ "attrs", arg.substr(0, found) },
+                            arg.substr(found+1));
+      }
+    }
+  }
+  return js.toString();
+}
+
+/* Reports what was traced when ralsh exits, no matter how it exits */
+class trace_report {
+public:
+  trace_report(bool summary, const std::string& path)
+    : _summary(summary), _path(path) {
+    if (_summary || ! _path.empty())
+      lib::trace::enable();
+  }
+
+  ~trace_report() {
+    if (_summary) {
+      boost::nowide::cerr << endl;
+      lib::trace::write_summary(boost::nowide::cerr);
+    }
+    if (! _path.empty()) {
+      std::ofstream out(_path);
+      lib::trace::write_chrome(out);
+      if (! out) {
+        boost::nowide::cerr << _("failed to write trace to {1}", _path)
+                            << endl;
+      }
+    }
+  }
+
+private:
+  bool _summary;
+  std::string _path;
+};
+
 std::string progname(const char* argv0) {
   const char *progname = rindex(argv0, '/');
   if (progname == NULL) {
@@ -160,6 +559,48 @@ void use_fixed_layout(const char *argv0, const std::string& progname) {
 #endif
 }
 
+// The write end of the pipe through which on_interrupt tells the thread
+// started by cancel_on_interrupt which signal arrived
+static int interrupt_fd = -1;
+
+static void on_interrupt(int sig) {
+  unsigned char c = sig;
+  if (write(interrupt_fd, &c, 1) < 0) {
+    // Nothing we can safely do from a signal handler
+  }
+}
+
+// Local commands run in their own process group, and therefore do not see
+// the SIGINT from Ctrl-C or a SIGTERM sent to us. Cancel them when we get
+// one, and then die from the signal as we would have without the handler.
+// cancellation::cancel() is not async-signal-safe, so the handler only
+// hands the signal to a thread that does the actual work.
+void cancel_on_interrupt(const lib::cancellation::sptr& cancel) {
+  int fds[2];
+  if (pipe(fds) < 0) {
+    LOG_WARNING("failed to create pipe for interrupts: {1}", strerror(errno));
+    return;
+  }
+  interrupt_fd = fds[1];
+
+  std::thread([cancel, fds]() {
+      unsigned char c;
+      while (read(fds[0], &c, 1) < 0 && errno == EINTR)
+        ;
+      cancel->cancel();
+      signal(c, SIG_DFL);
+      raise(c);
+    }).detach();
+
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = on_interrupt;
+  sigemptyset(&sa.sa_mask);
+  sa.sa_flags = SA_RESTART;
+  sigaction(SIGINT, &sa, nullptr);
+  sigaction(SIGTERM, &sa, nullptr);
+}
+
 extern "C" {
   int prog_mruby(int argc, char **argv);
   int prog_mirb(int argc, char **argv);
@@ -198,6 +639,19 @@ int main(int argc, char **argv) {
       ("json,j", "produce JSON output")
       ("quiet,q", "suppress all normal output")
       ("absent,a", "consider resources with ensure=absent as missing")
+      ("all", "list the instances of all types")
+      ("apply", po::value<std::string>(), "change all the resources listed in the manifest '$arg'")
+      ("watch", "print changes to the given types, or to TYPE[NAME], as they happen")
+      ("snapshot", po::value<std::string>(), "write the state of the given types to the snapshot file '$arg'")
+      ("diff", po::value<std::vector<std::string>>(), "print how the current state differs from the snapshot '$arg'; when given twice, compare the two snapshots")
+      ("attrs", po::value<std::string>(), "when listing resources, only print the comma-separated attributes '$arg'")
+      ("filter", po::value<std::vector<std::string>>(), "when listing resources, only print those that match '$arg', like 'uid>=1000'; can be given several times")
+      ("jobs", po::value<unsigned int>()->default_value(0, "one per core"), "when working with several types, run at most '$arg' providers at once")
+      ("daemon", po::value<std::string>(), "serve requests on the Unix domain socket '$arg'")
+      ("connect", po::value<std::string>(), "send the request to the ralsh daemon listening on '$arg'")
+      ("timeout", po::value<unsigned int>(), "kill commands that providers run after '$arg' seconds, overriding the timeouts in their metadata")
+      ("profile", "print where time was spent to stderr when done")
+      ("trace", po::value<std::string>(), "write a trace of where time was spent in Chrome trace format to '$arg'")
       ("version", "print the version and exit");
 
     po::options_description all_options(command_line_options);
@@ -257,14 +711,145 @@ int main(int argc, char **argv) {
                           << color::reset << endl;
     }
 
+    if (vm.count("daemon") && vm.count("connect")) {
+      boost::nowide::cerr << "error: " << "you can not specify --daemon and --connect at the same time" << endl;
+      return EXIT_ERROR;
+    }
+
+    // Everything we trace is kept in memory until we exit, which a daemon
+    // or a watch never does
+    if ((vm.count("profile") || vm.count("trace")) &&
+        (vm.count("daemon") || vm.count("watch"))) {
+      boost::nowide::cerr << "error: " << "you can not combine --profile or --trace with --daemon or --watch" << endl;
+      return EXIT_ERROR;
+    }
+
+    if (vm.count("apply") &&
+        (vm.count("type") || vm.count("all") || vm.count("daemon") ||
+         vm.count("connect") || explain)) {
+      boost::nowide::cerr << "error: " << "you can not combine --apply with a type, --all, --explain, --daemon or --connect" << endl;
+      return EXIT_ERROR;
+    }
+
+    // Listing several types, either with --all or as TYPE1,TYPE2,...
+    std::vector<std::string> types;
+    bool all = vm.count("all");
+    if (vm.count("type")) {
+      boost::split(types, vm["type"].as<std::string>(),
+                   boost::is_any_of(","), boost::token_compress_on);
+    }
+    bool many = all || types.size() > 1;
+    if (many) {
+      if (all && vm.count("type")) {
+        boost::nowide::cerr << "error: " << "you can not specify --all and a type at the same time" << endl;
+        return EXIT_ERROR;
+      }
+      if (vm.count("name") || explain) {
+        boost::nowide::cerr << "error: " << "you can only list the instances of several types, not find, modify or explain them" << endl;
+        return EXIT_ERROR;
+      }
+      if (vm.count("connect")) {
+        boost::nowide::cerr << "error: " << "you can not list several types with --connect" << endl;
+        return EXIT_ERROR;
+      }
+    }
+
+    // Only asking for some attributes
+    std::vector<std::string> attrs;
+    if (vm.count("attrs")) {
+      if (vm.count("apply") || vm.count("watch") || vm.count("snapshot") ||
+          vm.count("diff") || vm.count("daemon") || vm.count("connect") ||
+          vm.count("attr-value") || explain) {
+        boost::nowide::cerr << "error: " << "--attrs only works when listing resources, not with --apply, --watch, --snapshot, --diff, --daemon, --connect, --explain or attributes" << endl;
+        return EXIT_ERROR;
+      }
+      boost::split(attrs, vm["attrs"].as<std::string>(),
+                   boost::is_any_of(","), boost::token_compress_on);
+    }
+
+    // Only listing the resources that match a filter
+    lib::filter filt;
+    if (vm.count("filter")) {
+      if (vm.count("apply") || vm.count("watch") || vm.count("snapshot") ||
+          vm.count("diff") || vm.count("daemon") || vm.count("connect") ||
+          vm.count("name") || explain) {
+        boost::nowide::cerr << "error: " << "--filter only works when listing all resources of some types, not with --apply, --watch, --snapshot, --diff, --daemon, --connect, --explain or a resource name" << endl;
+        return EXIT_ERROR;
+      }
+      auto res = lib::filter::parse(vm["filter"].as<std::vector<std::string>>());
+      if (! res) {
+        boost::nowide::cerr << "error: " << res.err().detail << endl;
+        return EXIT_ERROR;
+      }
+      filt = res.ok();
+    }
+
+    if (vm.count("watch")) {
+      if (vm.count("apply") || vm.count("snapshot") || vm.count("diff") ||
+          vm.count("daemon") || vm.count("connect") || vm.count("target") ||
+          vm.count("attr-value") || explain) {
+        boost::nowide::cerr << "error: " << "you can not combine --watch with --apply, --snapshot, --diff, --daemon, --connect, --target, --explain or attributes" << endl;
+        return EXIT_ERROR;
+      }
+      if (! many && types.empty()) {
+        boost::nowide::cerr << "error: " << "please provide the types to watch, or --all" << endl;
+        return EXIT_ERROR;
+      }
+    }
+
+    bool snapshot = vm.count("snapshot");
+    bool diff = vm.count("diff");
+    if (snapshot || diff) {
+      if (snapshot && diff) {
+        boost::nowide::cerr << "error: " << "you can not specify --snapshot and --diff at the same time" << endl;
+        return EXIT_ERROR;
+      }
+      if (vm.count("apply") || vm.count("daemon") || vm.count("connect") ||
+          vm.count("name") || explain) {
+        boost::nowide::cerr << "error: " << "you can not combine --snapshot or --diff with --apply, --daemon, --connect, --explain or a resource name" << endl;
+        return EXIT_ERROR;
+      }
+      if (snapshot && ! many && types.empty()) {
+        boost::nowide::cerr << "error: " << "please provide the types to snapshot, or --all" << endl;
+        return EXIT_ERROR;
+      }
+      if (diff && (many || ! types.empty())) {
+        boost::nowide::cerr << "error: " << "--diff compares the types that are in the snapshot, you can not give any" << endl;
+        return EXIT_ERROR;
+      }
+      if (diff && vm["diff"].as<std::vector<std::string>>().size() > 2) {
+        boost::nowide::cerr << "error: " << "you can compare at most two snapshots" << endl;
+        return EXIT_ERROR;
+      }
+    }
+
+    trace_report report(vm.count("profile"),
+                        vm.count("trace") ? vm["trace"].as<std::string>() : "");
+
+    if (vm.count("connect")) {
+      // The daemon does all the work
+      return rpc::call(vm["connect"].as<std::string>(), make_request(vm));
+    }
+
     // Figure out our include path
     std::vector<std::string> data_dirs;
     if (vm.count("include")) {
       data_dirs = vm["include"].as<std::vector<std::string>>();
     }
 
+    lib::limits lim;
+    if (vm.count("timeout")) {
+      lim.timeout = vm["timeout"].as<unsigned int>();
+    }
+    if (! vm.count("daemon")) {
+      // The daemon handles SIGINT and SIGTERM itself
+      lim.cancel = lib::cancellation::create();
+      cancel_on_interrupt(lim.cancel);
+    }
+
     // Do the actual work
     auto ral = lib::ral::create(data_dirs);
+    ral->set_describe_limits(lim);
     if (vm.count("target")) {
       auto target = vm["target"].as<std::string>();
       auto res = ral->connect(target, vm.count("sudo"), vm.count("keep"));
@@ -277,6 +862,15 @@ int main(int argc, char **argv) {
         return EXIT_ERROR;
       }
     }
+    if (vm.count("daemon")) {
+      if (vm.count("type")) {
+        boost::nowide::cerr << color::yellow
+           << "warning: ignoring positional arguments with --daemon"
+                            << color::reset << endl;
+      }
+      return rpc::serve(ral, vm["daemon"].as<std::string>(), lim);
+    }
+
     std::unique_ptr<lib::emitter> emp;
     if (vm.count("quiet")) {
       emp = std::unique_ptr<lib::emitter>(new lib::quiet_emitter());
@@ -287,7 +881,23 @@ int main(int argc, char **argv) {
     }
     lib::emitter& em = *emp;
 
-    if (vm.count("type")) {
+    if (vm.count("watch")) {
+      return watch(*ral, types, all,
+                   vm.count("name") ? vm["name"].as<std::string>() : "",
+                   lim, em);
+    } else if (snapshot) {
+      return write_snapshot(*ral, vm["snapshot"].as<std::string>(), types,
+                            all, vm["jobs"].as<unsigned int>(), lim);
+    } else if (diff) {
+      return diff_snapshots(*ral, vm["diff"].as<std::vector<std::string>>(),
+                            vm["jobs"].as<unsigned int>(), lim, em);
+    } else if (vm.count("apply")) {
+      return apply::run(*ral, vm["apply"].as<std::string>(),
+                        vm["jobs"].as<unsigned int>(), lim, em);
+    } else if (many) {
+      return list_many(*ral, types, all, vm["jobs"].as<unsigned int>(),
+                       lim, attrs, filt, em);
+    } else if (vm.count("type")) {
       // We have a type name
       auto type_name = vm["type"].as<std::string>();
       auto opt_prov = ral->find_provider(type_name);
@@ -332,14 +942,14 @@ int main(int argc, char **argv) {
             }
           }
 
-          auto res = prov.set({ should });
+          auto res = prov.set({ should }, lim);
           em.print_set(prov, res);
           if (!res) {
             return EXIT_ERROR;
           }
         } else {
           // No attributes, dump the resource
-          auto inst = prov.find(name);
+          auto inst = prov.find(name, lim, attrs);
           em.print_find(prov, inst);
           if (!inst) {
             return EXIT_ERROR;
@@ -351,7 +961,7 @@ int main(int argc, char **argv) {
         }
       } else {
         // No resource name, dump all resources of the provider
-        auto insts = prov.get();
+        auto insts = prov.get({ }, lim, attrs, filt);
         em.print_list(prov, insts);
         if (!insts) {
             return EXIT_ERROR;
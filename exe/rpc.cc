@@ -0,0 +1,327 @@
+#include "rpc.hpp"
+
+#include <libral/emitter/json_emitter.hpp>
+
+#include <boost/nowide/iostream.hpp>
+#include <leatherman/json_container/json_container.hpp>
+#include <leatherman/logging/logging.hpp>
+#include <leatherman/locale/locale.hpp>
+
+#include <algorithm>
+
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+using namespace leatherman::locale;
+namespace lib = libral;
+namespace json = leatherman::json_container;
+using json_container = json::JsonContainer;
+
+namespace rpc {
+
+  // Same as in ralsh.cc
+  const static int EXIT_ERROR = 2;
+
+  // How long we wait for a client to send its request, or to take our
+  // answer, in seconds
+  const static int client_timeout = 5;
+
+  // The largest request we accept, in bytes
+  const static size_t max_request = 1024 * 1024;
+
+  static volatile sig_atomic_t stop_serving = 0;
+
+  static void on_signal(int) {
+    stop_serving = 1;
+  }
+
+  static bool make_address(const std::string& path, struct sockaddr_un& addr) {
+    if (path.size() >= sizeof(addr.sun_path)) {
+      boost::nowide::cerr << _("socket path is too long: {1}", path)
+                          << std::endl;
+      return false;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    return true;
+  }
+
+  static bool write_all(int fd, const std::string& buf) {
+    size_t done = 0;
+    while (done < buf.size()) {
+      auto n = write(fd, buf.data() + done, buf.size() - done);
+      if (n < 0) {
+        if (errno == EINTR)
+          continue;
+        return false;
+      }
+      done += n;
+    }
+    return true;
+  }
+
+  /* Read from fd until EOF, or until the first newline if upto_newline is
+     true. The newline is not added to buf. If max is not 0 and buf would
+     grow beyond max bytes, fail with errno set to EMSGSIZE */
+  static bool read_all(int fd, std::string& buf, bool upto_newline,
+                       size_t max = 0) {
+    char chunk[4096];
+    while (true) {
+      auto n = read(fd, chunk, sizeof(chunk));
+      if (n < 0) {
+        if (errno == EINTR)
+          continue;
+        return false;
+      }
+      if (n == 0)
+        return true;
+      size_t len = n;
+      bool done = false;
+      if (upto_newline) {
+        auto nl = static_cast<char *>(memchr(chunk, '\n', n));
+        if (nl != nullptr) {
+          len = nl - chunk;
+          done = true;
+        }
+      }
+      if (max > 0 && buf.size() + len > max) {
+        errno = EMSGSIZE;
+        return false;
+      }
+      buf.append(chunk, len);
+      if (done)
+        return true;
+    }
+  }
+
+  static std::string error_json(const std::string& msg) {
+    json_container js, err;
+    err.set<std::string>("message", msg);
+    js.set<json_container>("error", err);
+    return js.toString();
+  }
+
+  /* Answer the request req using the providers provs and put the JSON
+     answer into out. Returns the exit status ralsh would have had for the
+     same request */
+  static int handle(const std::vector<std::shared_ptr<lib::provider>>& provs,
+                    const std::string& req, std::string& out,
+                    const lib::limits& dflt_lim) {
+    lib::json_emitter em;
+
+    try {
+      json_container js(req);
+
+      auto action = js.getWithDefault<std::string>("action", "get");
+      auto lim = dflt_lim;
+      if (js.includes("timeout")) {
+        lim.timeout = std::max(0, js.get<int>("timeout"));
+      }
+
+      if (action == "describe" && ! js.includes("type")) {
+        out = em.parse_providers(provs);
+        return EXIT_SUCCESS;
+      }
+
+      if (! js.includes("type")) {
+        out = error_json(_("the request is missing a 'type'"));
+        return EXIT_ERROR;
+      }
+
+      auto type_name = js.get<std::string>("type");
+      auto opt_prov = lib::ral::find_provider(type_name, provs);
+      if (opt_prov == boost::none) {
+        out = error_json(_("unknown provider: '{1}'", type_name));
+        return EXIT_ERROR;
+      }
+      auto& prov = **opt_prov;
+
+      if (action == "describe") {
+        out = em.parse_providers({ *opt_prov });
+        return EXIT_SUCCESS;
+      }
+
+      if (action == "get") {
+        if (! js.includes("name")) {
+          auto insts = prov.get({ }, lim);
+          out = em.parse_list(prov, insts);
+          return insts ? EXIT_SUCCESS : EXIT_ERROR;
+        }
+
+        auto inst = prov.find(js.get<std::string>("name"), lim);
+        out = em.parse_find(prov, inst);
+        if (!inst) {
+          return EXIT_ERROR;
+        }
+        bool err_on_absent = js.getWithDefault<bool>("absent", false);
+        if (! inst.ok() ||
+            (err_on_absent && (*inst.ok())["ensure"] == lib::value("absent"))) {
+          return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+      }
+
+      if (action == "set") {
+        if (! js.includes("name") || ! js.includes("attrs")) {
+          out = error_json(_("a 'set' request needs a 'name' and 'attrs'"));
+          return EXIT_ERROR;
+        }
+
+        auto should = prov.create(js.get<std::string>("name"));
+        auto attrs = js.get<json_container>("attrs");
+        for (const auto& attr : attrs.keys()) {
+          auto value = prov.parse(attr, attrs.get<std::string>(attr));
+          if (!value) {
+            out = error_json(_("failed to read attribute {1}: {2}", attr,
+                               value.err().detail));
+            return EXIT_ERROR;
+          }
+          should[attr] = value.ok();
+        }
+
+        auto res = prov.set({ should }, lim);
+        out = em.parse_set(prov, res);
+        return res ? EXIT_SUCCESS : EXIT_ERROR;
+      }
+
+      out = error_json(_("unknown action '{1}', expected one of 'get', 'set', or 'describe'", action));
+      return EXIT_ERROR;
+    } catch (json::data_error& ex) {
+      out = error_json(_("malformed request: {1}", ex.what()));
+      return EXIT_ERROR;
+    }
+  }
+
+  int serve(std::shared_ptr<lib::ral> ral, const std::string& path,
+            const lib::limits& lim) {
+    struct sockaddr_un addr;
+    if (! make_address(path, addr))
+      return EXIT_ERROR;
+
+    // Discovering providers is what makes every ralsh run slow; do it
+    // once and keep the providers, and whatever state they cache, around
+    // for all requests
+    auto provs = ral->providers();
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+      boost::nowide::cerr << _("failed to create socket: {1}", strerror(errno))
+                          << std::endl;
+      return EXIT_ERROR;
+    }
+
+    // Clean up after a daemon that did not exit cleanly, but never remove
+    // anything that is not a socket
+    struct stat st;
+    if (lstat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+      unlink(path.c_str());
+    }
+
+    // Requests can change the system; only our own user may connect
+    auto old_mask = umask(0077);
+    auto r = bind(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr));
+    umask(old_mask);
+    if (r < 0 || listen(fd, 16) < 0) {
+      boost::nowide::cerr << _("failed to listen on {1}: {2}",
+                               path, strerror(errno)) << std::endl;
+      close(fd);
+      return EXIT_ERROR;
+    }
+
+    // Leave SA_RESTART off so that accept() returns when we are told to
+    // stop
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    LOG_INFO("serving {1} providers on {2}", provs.size(), path);
+
+    while (! stop_serving) {
+      int conn = accept4(fd, nullptr, nullptr, SOCK_CLOEXEC);
+      if (conn < 0) {
+        if (errno == EINTR || errno == ECONNABORTED)
+          continue;
+        LOG_ERROR("failed to accept connection: {1}", strerror(errno));
+        break;
+      }
+
+      // Requests are served one at a time; make sure a client that never
+      // sends anything, or never reads our answer, can not hang us
+      struct timeval tv = { client_timeout, 0 };
+      setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+      setsockopt(conn, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+      std::string req, out;
+      int status;
+      if (read_all(conn, req, true, max_request)) {
+        status = handle(provs, req, out, lim);
+      } else if (errno == EMSGSIZE) {
+        LOG_WARNING("rejecting request larger than {1} bytes", max_request);
+        status = EXIT_ERROR;
+        out = error_json(_("the request is larger than {1} bytes",
+                           max_request));
+      } else {
+        LOG_WARNING("failed to read request: {1}", strerror(errno));
+        status = EXIT_ERROR;
+        out = error_json(_("failed to read request"));
+      }
+
+      if (! write_all(conn, std::to_string(status) + "\n" + out + "\n")) {
+        LOG_WARNING("failed to send answer: {1}", strerror(errno));
+      }
+      close(conn);
+    }
+
+    close(fd);
+    unlink(path.c_str());
+    return EXIT_SUCCESS;
+  }
+
+  int call(const std::string& path, const std::string& request) {
+    struct sockaddr_un addr;
+    if (! make_address(path, addr))
+      return EXIT_ERROR;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 ||
+        connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) < 0) {
+      boost::nowide::cerr << _("failed to connect to ralsh daemon at {1}: {2}",
+                               path, strerror(errno)) << std::endl;
+      if (fd >= 0)
+        close(fd);
+      return EXIT_ERROR;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+
+    std::string answer;
+    bool ok = write_all(fd, request + "\n")
+      && shutdown(fd, SHUT_WR) == 0
+      && read_all(fd, answer, false);
+    close(fd);
+
+    // The answer is the exit status on a line by itself, followed by the
+    // JSON output
+    auto nl = answer.find('\n');
+    if (! ok || nl == 0 || nl == std::string::npos
+        || answer.find_first_not_of("0123456789") != nl) {
+      boost::nowide::cerr << _("failed to get an answer from ralsh daemon at {1}",
+                               path) << std::endl;
+      return EXIT_ERROR;
+    }
+
+    boost::nowide::cout << answer.substr(nl + 1);
+    return std::stoi(answer.substr(0, nl));
+  }
+}
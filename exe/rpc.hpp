@@ -0,0 +1,30 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <libral/ral.hpp>
+
+/* Support for 'ralsh --daemon' and 'ralsh --connect'. The daemon keeps one
+ * ral instance and its providers around and answers requests that clients
+ * send over a Unix domain socket; see doc/ralsh-daemon.md for the
+ * protocol. */
+namespace rpc {
+
+  /**
+   * Listens on the Unix domain socket \p path and answers requests with
+   * the providers of \p ral until it receives SIGINT or SIGTERM. Provider
+   * calls are subject to \p lim unless a request asks for a different
+   * timeout. Returns the exit status for ralsh.
+   */
+  int serve(std::shared_ptr<libral::ral> ral, const std::string& path,
+            const libral::limits& lim);
+
+  /**
+   * Sends \p request, which must be a JSON request as described in
+   * doc/ralsh-daemon.md, to the daemon listening on \p path and prints
+   * the JSON answer on stdout. Returns the exit status the daemon
+   * reported for the request.
+   */
+  int call(const std::string& path, const std::string& request);
+}
@@ -0,0 +1,103 @@
+#include "bench.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include <leatherman/json_container/json_container.hpp>
+
+#include <libral/version.h>
+
+namespace fs = boost::filesystem;
+using json = leatherman::json_container::JsonContainer;
+
+namespace bench {
+
+  size_t scaled(const options& opts, size_t n) {
+    return opts.quick ? std::max<size_t>(n / 100, 2) : n;
+  }
+
+  bool wanted(const options& opts, const std::string& name) {
+    return name.compare(0, opts.filter.size(), opts.filter) == 0;
+  }
+
+  static json header(const std::string& name,
+                     const std::map<std::string, size_t>& params) {
+    json js;
+    js.set<std::string>("bench", name);
+    js.set<std::string>("version", LIBRAL_VERSION_WITH_COMMIT);
+    for (const auto& p : params) {
+      js.set<int>(p.first, static_cast<int>(p.second));
+    }
+    return js;
+  }
+
+  bool run(const options& opts, const std::string& name,
+           const std::map<std::string, size_t>& params,
+           const std::function<void()>& fn,
+           const std::function<void()>& prepare) {
+    using clock = std::chrono::steady_clock;
+
+    auto js = header(name, params);
+    std::vector<double> times;
+    try {
+      for (int i = 0; i <= opts.iterations; i++) {
+        if (prepare)
+          prepare();
+        auto start = clock::now();
+        fn();
+        auto end = clock::now();
+        // The first run is a warmup run
+        if (i > 0) {
+          times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+        }
+      }
+    } catch (std::exception& e) {
+      js.set<std::string>("error", e.what());
+      std::cout << js.toString() << std::endl;
+      return false;
+    }
+
+    std::sort(times.begin(), times.end());
+    double total = 0;
+    for (auto t : times) {
+      total += t;
+    }
+    js.set<int>("iterations", opts.iterations);
+    js.set<double>("min_ms", times.front());
+    js.set<double>("median_ms", times[times.size() / 2]);
+    js.set<double>("mean_ms", total / times.size());
+    js.set<double>("max_ms", times.back());
+    std::cout << js.toString() << std::endl;
+    return true;
+  }
+
+  void write_file(const fs::path& path, const std::string& content,
+                  bool exec) {
+    fs::create_directories(path.parent_path());
+    std::ofstream out(path.native());
+    out << content;
+    out.close();
+    if (! out) {
+      throw failure("failed to write " + path.native());
+    }
+    if (exec) {
+      fs::permissions(path, fs::add_perms | fs::owner_exe | fs::group_exe
+                      | fs::others_exe);
+    }
+  }
+
+  scratch_dir::scratch_dir()
+    : _path(fs::temp_directory_path() / fs::unique_path("libral_bench_%%%%-%%%%")) {
+    fs::create_directories(_path);
+  }
+
+  scratch_dir::~scratch_dir() {
+    boost::system::error_code ec;
+    fs::remove_all(_path, ec);
+  }
+}
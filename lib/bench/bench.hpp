@@ -0,0 +1,80 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+#include <boost/filesystem/path.hpp>
+
+/**
+ * A minimal harness for libral_bench. Every benchmark prints one JSON
+ * object per line to stdout so that results can be stored and compared
+ * across commits.
+ */
+namespace bench {
+
+  /**
+   * Settings that apply to all benchmarks
+   */
+  struct options {
+    /* How often each benchmark is timed, after one untimed warmup run */
+    int iterations = 5;
+    /* Shrink all fixtures so that a run takes very little time; used to
+       check that the benchmarks still work */
+    bool quick = false;
+    /* Only run benchmarks whose name starts with this */
+    std::string filter;
+  };
+
+  /**
+   * Thrown by benchmarks when the operation they measure fails
+   */
+  struct failure : std::runtime_error {
+    explicit failure(const std::string& msg) : std::runtime_error(msg) { }
+  };
+
+  /**
+   * The fixture size to use for a benchmark that has size \p n in a full
+   * run
+   */
+  size_t scaled(const options& opts, size_t n);
+
+  /**
+   * Returns true if the benchmark \p name should run
+   */
+  bool wanted(const options& opts, const std::string& name);
+
+  /**
+   * Times \p fn and prints the results for the benchmark \p name together
+   * with \p params, which describe the size of the fixtures. If \p prepare
+   * is given, it is called before each call to \p fn and is not timed.
+   *
+   * Returns false, after printing the error, if \p fn or \p prepare throw
+   * an exception.
+   */
+  bool run(const options& opts, const std::string& name,
+           const std::map<std::string, size_t>& params,
+           const std::function<void()>& fn,
+           const std::function<void()>& prepare = nullptr);
+
+  /**
+   * Writes \p content to the file \p path, creating the directories
+   * leading up to it. Makes the file executable if \p exec is true.
+   */
+  void write_file(const boost::filesystem::path& path,
+                  const std::string& content, bool exec = false);
+
+  /**
+   * A temporary directory that is removed with everything in it when this
+   * object is destroyed
+   */
+  class scratch_dir {
+  public:
+    scratch_dir();
+    ~scratch_dir();
+    const boost::filesystem::path& path() const { return _path; }
+  private:
+    boost::filesystem::path _path;
+  };
+}
@@ -0,0 +1,421 @@
+#include "bench.hpp"
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+#include <boost/algorithm/string/trim.hpp>
+#include <boost/filesystem.hpp>
+
+#include <libral/ral.hpp>
+#include <libral/simple_parser.hpp>
+#include <libral/emitter/json_emitter.hpp>
+
+namespace fs = boost::filesystem;
+namespace lib = libral;
+
+using bench::options;
+using bench::scaled;
+using bench::write_file;
+
+/* The resources that the list fixtures produce, and the attributes of the
+   providers that produce them */
+static const std::vector<std::string> list_attrs =
+  { "ensure", "owner", "group", "mode", "comment" };
+
+static std::string list_metadata(const std::string& type,
+                                 const std::string& invoke) {
+  std::ostringstream yaml;
+  yaml << "---\nprovider:\n"
+       << "  type: " << type << "\n"
+       << "  desc: Synthetic provider for libral_bench\n"
+       << "  invoke: " << invoke << "\n"
+       << "  actions: [list, get]\n"
+       << "  suitable: true\n"
+       << "  attributes:\n"
+       << "    name:\n";
+  for (const auto& attr : list_attrs) {
+    yaml << "    " << attr << ":\n";
+  }
+  return yaml.str();
+}
+
+static std::string list_value(const std::string& attr, size_t i) {
+  if (attr == "ensure")
+    return "present";
+  return attr + "_value_" + std::to_string(i);
+}
+
+static std::shared_ptr<lib::provider>
+need_provider(std::shared_ptr<lib::ral>& ral, const std::string& name) {
+  auto prov = ral->find_provider(name);
+  if (! prov) {
+    throw bench::failure("provider " + name + " not found or not suitable");
+  }
+  return *prov;
+}
+
+static std::vector<lib::resource>
+need_resources(lib::provider& prov, size_t at_least,
+               const std::vector<std::string>& attrs = { }) {
+  auto rsrcs = prov.get({ }, lib::limits(), attrs);
+  if (! rsrcs) {
+    throw bench::failure(rsrcs.err().detail);
+  }
+  if (rsrcs.ok().size() < at_least) {
+    throw bench::failure("expected at least " + std::to_string(at_least)
+                         + " resources but got "
+                         + std::to_string(rsrcs.ok().size()));
+  }
+  return rsrcs.ok();
+}
+
+/*
+ * Provider discovery with n synthetic external providers in addition to
+ * the ones in the default data directory
+ */
+static bool bench_discovery(const options& opts, const fs::path& root) {
+  auto n = scaled(opts, 50);
+  auto dir = root / "discovery";
+  for (size_t i = 0; i < n; i++) {
+    auto base = dir / "providers" / ("bench" + std::to_string(i));
+    write_file(base.native() + ".prov", "#!/bin/sh\nexit 0\n", true);
+    write_file(base.native() + ".yaml",
+               "---\nprovider:\n"
+               "  type: bench" + std::to_string(i) + "\n"
+               "  desc: Synthetic provider for libral_bench\n"
+               "  invoke: simple\n"
+               "  actions: [list]\n"
+               "  suitable:\n"
+               "    commands: [sh]\n"
+               "  attributes:\n"
+               "    name:\n");
+  }
+
+  return bench::run(opts, "discovery", { { "providers", n } }, [&dir, n]() {
+      auto ral = lib::ral::create({ dir.native() });
+      if (ral->providers().size() < n) {
+        throw bench::failure("not all synthetic providers were found");
+      }
+    });
+}
+
+/*
+ * Parsing large outputs of simple and json providers, and serializing
+ * them with the JSON emitter
+ */
+static bool bench_lists(const options& opts, const fs::path& root) {
+  auto n = scaled(opts, 10000);
+  auto dir = root / "lists";
+  auto provs = dir / "providers";
+  bool ok = true;
+
+  std::ostringstream simple, json;
+  simple << "# simple\n";
+  json << "{\"resources\":[";
+  for (size_t i = 0; i < n; i++) {
+    auto name = "resource" + std::to_string(i);
+    simple << "name: " << name << "\n";
+    json << (i > 0 ? "," : "") << "{\"name\":\"" << name << "\"";
+    for (const auto& attr : list_attrs) {
+      simple << attr << ": " << list_value(attr, i) << "\n";
+      json << ",\"" << attr << "\":\"" << list_value(attr, i) << "\"";
+    }
+    json << "}";
+  }
+  json << "]}\n";
+
+  // The scripts just print the canned output, so that we measure how
+  // fast libral processes it
+  write_file(dir / "bench_simple.out", simple.str());
+  write_file(provs / "bench_simple.prov",
+             "#!/bin/sh\nexec cat \"" + (dir / "bench_simple.out").native() + "\"\n",
+             true);
+  write_file(provs / "bench_simple.yaml",
+             list_metadata("bench_simple", "simple"));
+  write_file(dir / "bench_json.out", json.str());
+  write_file(provs / "bench_json.prov",
+             "#!/bin/sh\ncat > /dev/null\nexec cat \"" + (dir / "bench_json.out").native() + "\"\n",
+             true);
+  write_file(provs / "bench_json.yaml", list_metadata("bench_json", "json"));
+
+  auto ral = lib::ral::create({ dir.native() });
+
+  if (bench::wanted(opts, "list_simple")) {
+    auto prov = need_provider(ral, "bench_simple");
+    ok = bench::run(opts, "list_simple", { { "resources", n } },
+                    [&prov, n]() { need_resources(*prov, n); }) && ok;
+  }
+
+  if (bench::wanted(opts, "list_json")) {
+    auto prov = need_provider(ral, "bench_json");
+    ok = bench::run(opts, "list_json", { { "resources", n } },
+                    [&prov, n]() { need_resources(*prov, n); }) && ok;
+  }
+
+  if (bench::wanted(opts, "emit_json")) {
+    auto prov = need_provider(ral, "bench_simple");
+    lib::result<std::vector<lib::resource>> rsrcs =
+      need_resources(*prov, n);
+    ok = bench::run(opts, "emit_json", { { "resources", n } },
+                    [&prov, &rsrcs]() {
+                      lib::json_emitter em;
+                      if (em.parse_list(*prov, rsrcs).empty()) {
+                        throw bench::failure("no output");
+                      }
+                    }) && ok;
+  }
+
+  if (bench::wanted(opts, "simple_parser")) {
+    auto lines = scaled(opts, 100000);
+    std::vector<std::string> input;
+    for (size_t i = 0; i < lines; i++) {
+      const auto& attr = list_attrs[i % list_attrs.size()];
+      input.push_back("  " + attr + ":  " + list_value(attr, i) + " ");
+    }
+    ok = bench::run(opts, "simple_parser", { { "lines", lines } },
+                    [&input]() {
+                      lib::simple_parser::string_ref key, value;
+                      for (const auto& line : input) {
+                        if (! lib::simple_parser::split(line, key, value)) {
+                          throw bench::failure("failed to split " + line);
+                        }
+                      }
+                    }) && ok;
+  }
+
+  // Turning lines of output into resources, once the way simple_provider
+  // did before it had simple_parser, copying every line into a new key
+  // and value and trimming them, and once the way it does now
+  if (bench::wanted(opts, "simple_resources")) {
+    auto prov = need_provider(ral, "bench_simple");
+    std::vector<std::string> input;
+    for (size_t i = 0; i < n; i++) {
+      input.push_back("name: resource" + std::to_string(i));
+      for (const auto& attr : list_attrs) {
+        input.push_back(attr + ": " + list_value(attr, i));
+      }
+    }
+    std::map<std::string, size_t> params =
+      { { "resources", n }, { "lines", input.size() } };
+
+    auto check = [n](const std::vector<lib::resource>& res) {
+      if (res.size() != n || res.back().attrs().size() != list_attrs.size()) {
+        throw bench::failure("resources were not built correctly");
+      }
+    };
+
+    if (bench::wanted(opts, "simple_resources_copy")) {
+      ok = bench::run(opts, "simple_resources_copy", params,
+                      [&prov, &input, &check]() {
+                        std::vector<lib::resource> res;
+                        for (const auto& line : input) {
+                          auto pos = line.find(':');
+                          auto key = line.substr(0, pos);
+                          auto value = line.substr(pos+1);
+                          boost::trim(value);
+                          if (key == "name") {
+                            res.push_back(prov->create(value));
+                          } else {
+                            res.back()[key] = value;
+                          }
+                        }
+                        check(res);
+                      }) && ok;
+    }
+
+    if (bench::wanted(opts, "simple_resources_split")) {
+      ok = bench::run(opts, "simple_resources_split", params,
+                      [&prov, &input, &check]() {
+                        std::vector<lib::resource> res;
+                        lib::simple_parser::string_ref key, value;
+                        for (const auto& line : input) {
+                          lib::simple_parser::split(line, key, value);
+                          if (key == "name") {
+                            res.push_back(prov->create(value.to_string()));
+                          } else {
+                            res.back()[key.to_string()] = value.to_string();
+                          }
+                        }
+                        check(res);
+                      }) && ok;
+    }
+  }
+  return ok;
+}
+
+/*
+ * Enumerating users and groups. These use the system's NSS databases; see
+ * --write-nss-fixtures for running them against a fixed database.
+ * user_list_no_groups asks for all attributes of users except their
+ * groups, which the user provider then does not look up
+ */
+static bool bench_accounts(const options& opts) {
+  struct account_bench {
+    std::string name;
+    std::string type;
+    std::vector<std::string> attrs;
+  };
+  static const std::vector<account_bench> benches = {
+    { "user_list", "user", { } },
+    { "user_list_no_groups", "user",
+      { "comment", "gid", "home", "shell", "uid" } },
+    { "group_list", "group", { } } };
+
+  bool ok = true;
+  auto ral = lib::ral::create({ });
+  for (const auto& b : benches) {
+    const auto& name = b.name;
+    const auto& type = b.type;
+    const auto& attrs = b.attrs;
+    if (! bench::wanted(opts, name))
+      continue;
+    // The number of entries depends on the system; find it first so that
+    // results can be told apart
+    std::shared_ptr<lib::provider> prov;
+    size_t count = 0;
+    try {
+      prov = need_provider(ral, type);
+      count = need_resources(*prov, 1, attrs).size();
+    } catch (std::exception& e) {
+      ok = bench::run(opts, name, { },
+                      [&e]() { throw bench::failure(e.what()); }) && ok;
+      continue;
+    }
+    ok = bench::run(opts, name, { { "entries", count } },
+                    [&prov, &attrs]() { need_resources(*prov, 1, attrs); }) && ok;
+  }
+  return ok;
+}
+
+static void write_nss_fixtures(const fs::path& dir, size_t n) {
+  std::ostringstream passwd, group;
+  passwd << "root:x:0:0:root:/root:/bin/sh\n";
+  group << "root:x:0:\n";
+  for (size_t i = 0; i < n; i++) {
+    auto id = std::to_string(10000 + i);
+    passwd << "user" << i << ":x:" << id << ":" << id
+           << ":Benchmark user " << i << ":/home/user" << i << ":/bin/sh\n";
+    group << "group" << i << ":x:" << id << ":user" << i << "\n";
+  }
+  write_file(dir / "passwd", passwd.str());
+  write_file(dir / "group", group.str());
+}
+
+/*
+ * The augeas-backed host and mount providers on large files. A cold run
+ * uses a fresh ral, a warm run keeps using the same provider
+ */
+static bool bench_augeas(const options& opts, const fs::path& root) {
+  auto hosts = scaled(opts, 5000);
+  auto mounts = scaled(opts, 2000);
+  auto aug_root = root / "augeas";
+  bool ok = true;
+
+  std::ostringstream hosts_file, fstab_file;
+  hosts_file << "127.0.0.1\tlocalhost\n";
+  for (size_t i = 0; i < hosts; i++) {
+    hosts_file << "10." << (i / 65536) % 256 << "." << (i / 256) % 256
+               << "." << i % 256 << "\thost" << i << ".example.com host"
+               << i << "\n";
+  }
+  for (size_t i = 0; i < mounts; i++) {
+    fstab_file << "/dev/mapper/vg-lv" << i << "\t/srv/data" << i
+               << "\text4\tdefaults\t0 2\n";
+  }
+  write_file(aug_root / "etc" / "hosts", hosts_file.str());
+  write_file(aug_root / "etc" / "fstab", fstab_file.str());
+
+  // Augeas resolves all paths relative to AUGEAS_ROOT
+  setenv("AUGEAS_ROOT", aug_root.c_str(), 1);
+
+  std::map<std::string, size_t> sizes = { { "host", hosts }, { "mount", mounts } };
+  for (const auto& type_size : sizes) {
+    const auto& type = type_size.first;
+    auto n = type_size.second;
+    std::map<std::string, size_t> params = { { "entries", n } };
+
+    std::shared_ptr<lib::ral> ral;
+    std::shared_ptr<lib::provider> prov;
+    auto fresh = [&ral, &prov, &type]() {
+      ral = lib::ral::create({ });
+      prov = need_provider(ral, type);
+    };
+    auto get = [&prov, n]() { need_resources(*prov, n); };
+
+    if (bench::wanted(opts, type + "_cold")) {
+      ok = bench::run(opts, type + "_cold", params, get, fresh) && ok;
+    }
+    if (bench::wanted(opts, type + "_warm")) {
+      try {
+        fresh();
+        ok = bench::run(opts, type + "_warm", params, get) && ok;
+      } catch (std::exception& e) {
+        ok = bench::run(opts, type + "_warm", params,
+                        [&e]() { throw bench::failure(e.what()); }) && ok;
+      }
+    }
+  }
+
+  unsetenv("AUGEAS_ROOT");
+  return ok;
+}
+
+static void usage() {
+  std::cout <<
+R"txt(Usage: libral_bench [OPTION]...
+Run libral benchmarks and print one JSON object per benchmark on stdout.
+
+Options:
+  --iterations N            time each benchmark N times (default 5)
+  --quick                   use tiny fixtures; only checks that the
+                            benchmarks work
+  --filter PREFIX           only run benchmarks whose name starts with PREFIX
+  --write-nss-fixtures DIR  write passwd and group files with many entries
+                            into DIR and exit. Run libral_bench under
+                            nss_wrapper with these files to get reproducible
+                            results for user_list and group_list
+)txt";
+}
+
+int main(int argc, char **argv) {
+  options opts;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool has_value = (i + 1 < argc);
+    if (arg == "--quick") {
+      opts.quick = true;
+    } else if (arg == "--iterations" && has_value) {
+      opts.iterations = std::max(1, atoi(argv[++i]));
+    } else if (arg == "--filter" && has_value) {
+      opts.filter = argv[++i];
+    } else if (arg == "--write-nss-fixtures" && has_value) {
+      write_nss_fixtures(argv[++i], scaled(opts, 5000));
+      return EXIT_SUCCESS;
+    } else if (arg == "--help" || arg == "-h") {
+      usage();
+      return EXIT_SUCCESS;
+    } else {
+      usage();
+      return EXIT_FAILURE;
+    }
+  }
+
+  bench::scratch_dir root;
+  bool ok = true;
+
+  try {
+    if (bench::wanted(opts, "discovery")) {
+      ok = bench_discovery(opts, root.path()) && ok;
+    }
+    ok = bench_lists(opts, root.path()) && ok;
+    ok = bench_accounts(opts) && ok;
+    ok = bench_augeas(opts, root.path()) && ok;
+  } catch (std::exception& e) {
+    std::cerr << "error: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
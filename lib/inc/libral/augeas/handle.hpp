@@ -3,8 +3,11 @@
 #include <vector>
 #include <memory>
 #include <string>
+#include <cstdint>
 #include <boost/optional.hpp>
 
+#include <sys/types.h>
+
 #include <augeas.h>
 
 #include <libral/result.hpp>
@@ -17,6 +20,12 @@ namespace libral { namespace augeas {
   public:
     using callback = std::function<void(::augeas *)>;
 
+    /**
+     * Identifies a state of the files loaded into the handle; see
+     * generation()
+     */
+    using token = uint64_t;
+
     ~handle() { aug_close(_augeas); }
 
     /**
@@ -25,12 +34,33 @@ namespace libral { namespace augeas {
     result<void>
     include(const std::string& lens, const std::string& glob);
 
-    /* Load all the files we set up with INCLUDE */
+    /**
+     * Load all the files we set up with INCLUDE. For handles that read
+     * local files, this does nothing if none of the files have changed on
+     * disk and the tree has not been modified since the last load or
+     * save.
+     */
     result<void> load(void);
 
     /* Save changes back to disk */
     result<void> save(void);
 
+    /**
+     * Returns a token that changes every time the files are actually
+     * (re)loaded or saved. If the token is the same as an earlier one,
+     * and changed_on_disk() is false, the tree still reflects the same
+     * file contents as when the earlier token was returned.
+     */
+    token generation() const { return _generation; }
+
+    /**
+     * Returns true if any of the files we manage have changed on disk
+     * since they were last loaded or saved, judging by their device,
+     * inode, modification and change time and size. Always returns true for handles
+     * with a custom reader, since we can not check their files.
+     */
+    bool changed_on_disk() const;
+
     /**
      * Matches the given path expression against the tree and returns all
      * the nodes matching it. */
@@ -114,12 +144,43 @@ namespace libral { namespace augeas {
     /* Checks _augeas for errors and return an error if there is one. */
     result<void> check_error() const;
 
+    /* The part of a file's stat information we use to detect changes. We
+       use the full resolution of the timestamps, and the change time, too,
+       so that we notice edits that keep the size the same even when they
+       happen within the same second */
+    struct fingerprint {
+      dev_t  dev;
+      ino_t  ino;
+      struct timespec mtime;
+      struct timespec ctime;
+      off_t  size;
+
+      bool operator==(const fingerprint& other) const;
+    };
+
+    /* Fingerprint all the files that the globs in _files match, as seen
+       below _root */
+    std::vector<fingerprint> fingerprints() const;
+
     ::augeas* _augeas;
     /* make_node_seq_next uses this to make sure we create unique sequence
        numbers for nodes that need it */
     int       _seq;
     callback  _reader;
     callback  _writer;
+    /* True if we use aug_load/aug_save and can therefore check the files
+       on disk for changes */
+    bool      _local;
+    /* True if the tree was modified since the last load or save */
+    bool      _dirty;
+    token     _generation;
+    /* The directory augeas treats as the root of the filesystem, without
+       a trailing '/'; empty for '/'. Set from AUGEAS_ROOT by aug_init */
+    std::string _root;
+    /* The files passed to include, and their fingerprints as of the last
+       load or save */
+    std::vector<std::string> _files;
+    std::vector<fingerprint> _prints;
   };
 
   } }
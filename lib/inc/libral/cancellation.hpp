@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <set>
+
+#include <sys/types.h>
+
+namespace libral {
+  /**
+   * Lets one thread stop work that libral is doing in another thread.
+   *
+   * Whatever runs a child process on behalf of a provider registers the
+   * child with the cancellation that applies to it for as long as the
+   * child runs. Calling cancel() kills all registered children together
+   * with everything they started, and makes sure that no new children get
+   * started; the provider call that was in progress then returns an
+   * error.
+   */
+  class cancellation {
+  public:
+    using sptr = std::shared_ptr<cancellation>;
+
+    static sptr create() { return std::make_shared<cancellation>(); }
+
+    /**
+     * Kills all registered children and marks this as cancelled. This can
+     * be called from any thread, and more than once.
+     */
+    void cancel();
+
+    bool cancelled() const { return _cancelled.load(); }
+
+    /**
+     * Registers the child \p pid. If it leads a process group, the whole
+     * group is killed on cancel(). Returns false, after killing the
+     * child, if this has been cancelled already.
+     */
+    bool attach(pid_t pid);
+
+    /**
+     * Unregisters the child \p pid once it has exited
+     */
+    void detach(pid_t pid);
+
+    /**
+     * Kills the child \p pid and, if it leads one, its process group
+     */
+    static void kill(pid_t pid);
+
+  private:
+    std::atomic<bool> _cancelled { false };
+    std::mutex        _mutex;
+    std::set<pid_t>   _pids;
+  };
+
+  /**
+   * Limits on running a child process
+   */
+  struct limits {
+    /* Seconds after which the child is killed; 0 means no limit */
+    unsigned int timeout = 0;
+    /* If set, cancelling it kills the child */
+    cancellation::sptr cancel;
+
+    limits() { }
+    limits(unsigned int t, const cancellation::sptr& c = nullptr)
+      : timeout(t), cancel(c) { }
+
+    /* True if the child should not be started at all */
+    bool cancelled() const { return cancel && cancel->cancelled(); }
+  };
+}
@@ -5,6 +5,8 @@
 
 #include <libral/result.hpp>
 #include <libral/target.hpp>
+#include <libral/coprocess.hpp>
+#include <libral/cancellation.hpp>
 
 namespace libral {
   /** A convenience wrapper around leatherman::execution for running simple
@@ -43,13 +45,35 @@ namespace libral {
       : _cmd(cmd), _tgt(tgt), _needs_upload(needs_upload) { }
 
     /* Run the command with the given args. If the command exits with a
-       non-zero exit code, return an error result */
-    libral::result<void> run(const std::vector<std::string>& args);
+       non-zero exit code, return an error result.
 
-    result execute(const std::vector<std::string>& args);
+       All the methods that run the command kill it when it exceeds the
+       timeout in lim or when lim's cancellation is cancelled, and then
+       report failure with an exit code of -1 and an explanation in the
+       error member of the result */
+    libral::result<void> run(const std::vector<std::string>& args,
+                             const limits& lim = limits());
 
     result execute(const std::vector<std::string>& args,
-                   const std::string& stdin);
+                   const limits& lim = limits());
+
+    result execute(const std::vector<std::string>& args,
+                   const std::string& stdin,
+                   const limits& lim = limits());
+
+    /* Run the command with the given args, passing stdin on its standard
+       input, and call stdout_callback and stderr_callback on each line of
+       output as soon as the command produces it. Nothing is buffered; the
+       output and error members of the returned result are always empty */
+    result execute(const std::vector<std::string>& args,
+                   const std::string& stdin,
+                   std::function<bool(std::string&)> stdout_callback,
+                   std::function<bool(std::string&)> stderr_callback,
+                   const limits& lim = limits());
+
+    /* Start the command with the given args as a coprocess that keeps
+       running until the returned object is destroyed */
+    libral::result<coprocess::sptr> spawn(const std::vector<std::string>& args);
 
     const std::string& path() const { return _cmd; }
 
@@ -57,11 +81,17 @@ namespace libral {
 
     bool each_line(std::vector<std::string> const& arguments,
                    std::function<bool(std::string&)> stdout_callback,
-                   std::function<bool(std::string&)> stderr_callback = nullptr);
+                   std::function<bool(std::string&)> stderr_callback = nullptr,
+                   const limits& lim = limits());
 
-  private:
+    /* Upload the command to the target if it needs that and has not been
+       uploaded yet. All the methods that run the command do this
+       themselves; since it changes the command's path, callers that run
+       the same command from several threads must call it first */
     libral::result<void> upload();
 
+  private:
+
     std::string  _cmd;
     target::sptr _tgt;
     bool         _needs_upload;
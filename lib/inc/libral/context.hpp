@@ -2,9 +2,13 @@
 
 #include <string>
 #include <map>
+#include <set>
+#include <vector>
 
 #include <libral/value.hpp>
 #include <libral/resource.hpp>
+#include <libral/cancellation.hpp>
+#include <libral/filter.hpp>
 
 namespace libral {
 
@@ -58,7 +62,65 @@ namespace libral {
 
   class context {
   public:
-    context(const std::shared_ptr<provider>& prov) : _prov(prov) { }
+    /**
+     * Creates the context for one call into PROV. A nonzero timeout in
+     * LIM overrides the timeouts from the provider's metadata; commands
+     * the provider runs are killed when LIM's cancellation is cancelled.
+     * ATTRS are the attributes the caller wants to see; if it is empty,
+     * the caller wants all of them. Only resources that match FILT are
+     * of interest to the caller.
+     */
+    context(const std::shared_ptr<provider>& prov,
+            const libral::limits& lim = libral::limits(),
+            const std::vector<std::string>& attrs = { },
+            const libral::filter& filt = libral::filter())
+      : _prov(prov), _limits(lim), _attrs(attrs), _filter(filt) { }
+
+    /**
+     * Returns the limits for running the provider's ACTION
+     */
+    libral::limits limits_for(const std::string& action) const;
+
+    /**
+     * Returns true if the caller wants the attribute ATTR in the resources
+     * that get returns. Providers can skip computing attributes that
+     * nobody asked for; the name and ensure, and the attributes the
+     * filter looks at, are always wanted.
+     */
+    bool wants(const std::string& attr) const;
+
+    /**
+     * Returns the attributes the caller asked for; empty if it wants all
+     * of them
+     */
+    const std::vector<std::string>& attrs() const { return _attrs; }
+
+    /**
+     * Returns the attributes that the provider has to look up: the ones
+     * the caller asked for and the ones the filter looks at; empty if it
+     * wants all of them. This is what external providers are told to
+     * compute, since provider::get needs the filter's attributes to check
+     * the resources they return.
+     */
+    std::vector<std::string> wanted_attrs() const;
+
+    /**
+     * Returns the filter that the caller wants resources to match
+     */
+    const libral::filter& filter() const { return _filter; }
+
+    /**
+     * Returns false if RES can not match the caller's filter, judging
+     * only by the attributes RES has so far. Providers call this before
+     * they look up expensive attributes, and skip resources that the
+     * caller would not see anyway.
+     */
+    bool admits(const resource& res) const { return _filter.admits(res); }
+
+    /**
+     * Returns true if the work done in this context has been cancelled
+     */
+    bool cancelled() const { return _limits.cancelled(); }
 
     /**
      * Logs a line which may start with a log level prefix '<LEVEL>:'.
@@ -92,12 +154,18 @@ namespace libral {
 
     /**
      * For any entry in names for which we do not have a resource in rsrcs,
-     * add one with ensure set to 'absent'
+     * add one with ensure set to 'absent'. The names in skipped belong to
+     * resources that exist, but that the provider left out of rsrcs
+     * because they do not match the filter; they are not absent.
      */
     void add_absent(std::vector<resource>& rsrcs,
-                    const std::vector<std::string>& names);
+                    const std::vector<std::string>& names,
+                    const std::set<std::string>& skipped = { });
   private:
     const std::shared_ptr<provider> _prov;
+    const libral::limits _limits;
+    const std::vector<std::string> _attrs;
+    const libral::filter _filter;
     std::map<std::string, changes> _changes;
   };
 }
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+
+#include <sys/types.h>
+
+#include <libral/result.hpp>
+#include <libral/cancellation.hpp>
+
+namespace libral {
+  /**
+   * A child process that stays alive across several requests. Each
+   * request is written to the child's stdin, and the child answers on its
+   * stdout. Both requests and answers are terminated by a line that
+   * contains nothing but 'ral_eom'. Lines that the child prints on stderr
+   * are passed to a callback while we wait for an answer.
+   *
+   * The child is told to exit by closing its stdin when the coprocess
+   * object is destroyed. If it, or anything it started, is still around
+   * a second later, its whole process group is killed.
+   */
+  class coprocess {
+  public:
+    using sptr = std::shared_ptr<coprocess>;
+
+    ~coprocess();
+
+    /**
+     * Starts the executable \p file with arguments \p args. If \p file
+     * does not contain a '/', it is looked up on the PATH.
+     */
+    static result<sptr> spawn(const std::string& file,
+                              const std::vector<std::string>& args);
+
+    /**
+     * Sends \p msg to the child, followed by an end-of-message marker, and
+     * returns everything the child prints on stdout before its own
+     * end-of-message marker. While waiting, \p err_cb is called for every
+     * line the child prints on stderr.
+     *
+     * If the child does not answer within \p lim.timeout seconds, or \p
+     * lim.cancel is cancelled while we wait, the child is killed.
+     *
+     * If this returns an error, the child has either died or the
+     * conversation is out of sync, and the coprocess should be discarded.
+     */
+    result<std::string> request(const std::string& msg,
+                                std::function<bool(std::string&)> err_cb,
+                                const limits& lim = limits());
+
+    /**
+     * Returns false if the child has printed anything on stdout that is
+     * not part of the answer to a request, like a second answer to the
+     * last one. Requests would then get stale answers, and the coprocess
+     * should be discarded.
+     */
+    bool in_sync();
+
+    /**
+     * Returns the process id of the child.
+     */
+    pid_t pid() const { return _pid; }
+
+  private:
+    coprocess(pid_t pid, int in, int out, int err)
+      : _pid(pid), _stdin(in), _stdout(out), _stderr(err) { }
+
+    result<void> write_all(const std::string& s);
+    void flush_stderr(std::function<bool(std::string&)>& err_cb, bool all);
+
+    pid_t       _pid;
+    int         _stdin;
+    int         _stdout;
+    int         _stderr;
+    /* Output from the child that we have read but not consumed yet */
+    std::string _out;
+    std::string _err;
+  };
+}
@@ -1,16 +1,96 @@
 #pragma once
 
+#include "stddef.h"
 #include "stdint.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/*
+ * Each of these functions creates a fresh ral and discovers all providers
+ * before doing its work. Use the handle-based functions below when more
+ * than one call is made.
+ *
+ * All strings returned through result must be released with
+ * free_result.
+ */
 uint8_t get_providers(char **result);
 uint8_t get_resource(char **result, char *type_name, char *resource_name);
 uint8_t set_resource(char **result, char *type_name, char *resource_name, int desired_attributes_c, char **desired_attributes);
 uint8_t get_resources(char **result, char *type_name);
 
+/* Release a string returned through the result argument of any function
+ * in this file. Passing NULL is fine. */
+void free_result(char *result);
+
+/*
+ * Handle-based interface. A ral handle discovers providers once, when it is
+ * opened, and keeps them until it is closed; provider handles are looked
+ * up in a ral handle and can be used for as many calls as needed. Handles
+ * must not be used from more than one thread at the same time.
+ */
+typedef struct ral_handle ral_handle;
+typedef struct ral_provider ral_provider;
+
+/* Create a ral that searches the data_dirs_c directories in data_dirs for
+ * providers in addition to the default ones. Never returns NULL. */
+ral_handle *ral_open(int data_dirs_c, char **data_dirs);
+void ral_close(ral_handle *ral);
+
+uint8_t ral_get_providers(ral_handle *ral, char **result);
+
+/* Look up the provider for type_name, which can be a type or a qualified
+ * provider name. Returns NULL if there is no such provider. The provider
+ * handle stays valid after ral is closed. */
+ral_provider *ral_find_provider(ral_handle *ral, char *type_name);
+void ral_provider_close(ral_provider *prov);
+
+uint8_t ral_provider_get_resources(ral_provider *prov, char **result);
+uint8_t ral_provider_get_resource(ral_provider *prov, char **result, char *resource_name);
+uint8_t ral_provider_set_resource(ral_provider *prov, char **result, char *resource_name, int desired_attributes_c, char **desired_attributes);
+
+/*
+ * Resources as flat records. Instead of a JSON string, these functions
+ * return an array of records that can be read directly, one record per
+ * attribute value. The records for a resource start with a
+ * RAL_RECORD_RESOURCE record and are followed by the records for its
+ * attributes and, for ral_provider_set_records, its changes.
+ */
+enum ral_record_kind {
+    RAL_RECORD_RESOURCE = 0, /* starts a new resource called name */
+    RAL_RECORD_STRING,       /* attribute attr has the string value */
+    RAL_RECORD_BOOL,         /* attribute attr is "true" or "false" in value */
+    RAL_RECORD_ARRAY,        /* attribute attr is an array; its elements
+                                follow as RAL_RECORD_ITEM records */
+    RAL_RECORD_ITEM,         /* value is the next element of the array */
+    RAL_RECORD_CHANGE        /* attribute attr changed from was to value */
+};
+
+typedef struct ral_record {
+    uint8_t kind;
+    const char *name;   /* the name of the resource the record belongs to */
+    const char *attr;   /* NULL for RAL_RECORD_RESOURCE */
+    const char *value;  /* NULL for RAL_RECORD_RESOURCE and RAL_RECORD_ARRAY */
+    const char *was;    /* only set for RAL_RECORD_CHANGE */
+} ral_record;
+
+typedef struct ral_records {
+    const char *type_name;  /* the type and qualified name of the provider */
+    const char *provider;   /* that produced the resources */
+    size_t count;
+    ral_record *records;
+    const char *error;      /* NULL, unless something went wrong */
+} ral_records;
+
+/* Put the resource called resource_name, or all resources if
+ * resource_name is NULL, into *result. On failure, (*result)->error
+ * describes the problem. *result is always set and must be released with
+ * ral_free_records. */
+uint8_t ral_provider_get_records(ral_provider *prov, ral_records **result, char *resource_name);
+uint8_t ral_provider_set_records(ral_provider *prov, ral_records **result, char *resource_name, int desired_attributes_c, char **desired_attributes);
+void ral_free_records(ral_records *records);
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,20 +1,49 @@
 #pragma once
 
 #include <libral/provider.hpp>
+#include <libral/snapshot.hpp>
 
 namespace libral {
   class emitter {
   public:
     using set_result = result<std::vector<std::pair<update, changes>>>;
+    using list_result = result<std::vector<resource>>;
+    /* The resources of several providers, in the order in which they
+     * should be printed */
+    using lists = std::vector<std::pair<std::shared_ptr<provider>,
+                                        list_result>>;
+    /* The outcome of changing the resources of several providers */
+    using sets = std::vector<std::pair<std::shared_ptr<provider>,
+                                       set_result>>;
 
     virtual void print_set(const provider &prov, const set_result& rslt) = 0;
 
+    /* Print the outcome of changing the resources of several providers as
+     * one document. By default, they are printed one provider after the
+     * other */
+    virtual void print_sets(const sets& sts) {
+      for (const auto& s : sts) {
+        print_set(*s.first, s.second);
+      }
+    }
+
     virtual void print_find(const provider &prov,
                  const result<boost::optional<resource>> &resource) = 0;
 
     virtual void print_list(const provider &prov,
                  const result<std::vector<resource>>& resources) = 0;
 
+    /* Print the resources of several providers as one document. By
+     * default, they are printed one provider after the other */
+    virtual void print_lists(const lists& lsts) {
+      for (const auto& l : lsts) {
+        print_list(*l.first, l.second);
+      }
+    }
+
+    virtual void
+    print_diff(const std::vector<snapshot::difference>& diffs) = 0;
+
     virtual void
     print_providers(const std::vector<std::shared_ptr<provider>>& provs) = 0;
   };
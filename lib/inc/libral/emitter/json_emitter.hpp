@@ -14,27 +14,46 @@ namespace libral {
 
     std::string parse_set(const provider &prov, const set_result& rslt);
 
+    std::string parse_sets(const sets& sts);
+
     std::string parse_find(const provider &prov,
                const result<boost::optional<resource>> &resource);
 
     std::string parse_list(const provider &prov,
                const result<std::vector<resource>>& resources);
 
+    std::string parse_lists(const lists& lsts);
+
+    std::string
+    parse_diff(const std::vector<snapshot::difference>& diffs);
+
     std::string
     parse_providers(const std::vector<std::shared_ptr<provider>>& provs);
 
     void print_set(const provider &prov, const set_result& rslt) override;
 
+    void print_sets(const sets& sts) override;
+
     void print_find(const provider &prov,
                const result<boost::optional<resource>> &resource) override;
 
     void print_list(const provider &prov,
                const result<std::vector<resource>>& resources) override;
 
+    void print_lists(const lists& lsts) override;
+
+    void
+    print_diff(const std::vector<snapshot::difference>& diffs) override;
+
     void
     print_providers(const std::vector<std::shared_ptr<provider>>& provs) override;
 
   private:
+    /* Append the changes in RSLT, which must be ok, to JS_RSLT */
+    void set_to_json(const provider &prov, const set_result& rslt,
+                     std::vector<json>& js_rslt);
+    /* The error of a provider in a document that covers several */
+    json error_to_json(const provider &prov, const error& err);
     json resource_to_json(const provider &prov, const resource &res);
     json json_meta(const provider &prov);
     /* Set KEY in JS by appropriately converting V */
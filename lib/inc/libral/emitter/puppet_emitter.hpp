@@ -10,12 +10,19 @@ namespace libral {
     puppet_emitter();
     void print_set(const provider &prov, const set_result& rslt) override;
 
+    void print_sets(const sets& sts) override;
+
     void print_find(const provider &prov,
                const result<boost::optional<resource>> &resource) override;
 
     void print_list(const provider &prov,
                const result<std::vector<resource>>& resources) override;
 
+    void print_lists(const lists& lsts) override;
+
+    void
+    print_diff(const std::vector<snapshot::difference>& diffs) override;
+
     void
     print_providers(const std::vector<std::shared_ptr<provider>>& provs) override;
 
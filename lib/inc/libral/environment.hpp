@@ -35,12 +35,20 @@ namespace libral {
     bool is_local() const;
 
     /**
-     * Creates an augeas handle that has the files described by \p xfms
-     * loaded.
+     * Returns an augeas handle that has the files described by \p xfms
+     * loaded. Targets may hand out the same handle for the same \p xfms
+     * more than once; the files are reloaded on every call, though
+     * unchanged files need not be reparsed.
      */
     result<std::shared_ptr<augeas::handle>>
     augeas(const std::vector<std::pair<std::string, std::string>>& xfms);
 
+    /**
+     * Returns the contents of the file at the absolute path \p path on
+     * the target
+     */
+    result<std::string> read(const std::string& path) const;
+
     const std::vector<std::string>& data_dirs() const;
 
     /**
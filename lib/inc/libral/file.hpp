@@ -65,6 +65,9 @@ namespace libral {
 
     result<void> set(context &ctx, const updates& upds) override;
 
+    std::vector<std::string>
+    watch_paths(const std::vector<std::string>& names) const override;
+
   protected:
     result<prov::spec> describe(environment &env) override;
   private:
@@ -80,7 +83,7 @@ namespace libral {
     result<void> create_file(const std::string& path);
     result<void> create_directory(const std::string& path);
 
-    void load(resource &res);
+    void load(const context &ctx, resource &res);
     void find_from_stat(resource &res);
     std::string time_as_iso_string(std::time_t *time);
   };
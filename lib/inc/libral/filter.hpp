@@ -0,0 +1,98 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <libral/result.hpp>
+#include <libral/resource.hpp>
+
+namespace libral {
+  /**
+   * A condition that the resources returned by provider::get must meet,
+   * like 'ensure=running' or 'uid>=1000'. A filter consists of any number
+   * of predicates, and a resource matches the filter if it matches all of
+   * them; the empty filter matches everything.
+   *
+   * Each predicate compares one attribute with an operand; it is written
+   * as ATTR OP OPERAND where OP is one of
+   *
+   *   =  !=     the attribute is (not) equal to the operand
+   *   <  <=  >  >=
+   *             the attribute is less or greater than the operand; if both
+   *             are integers, they are compared as numbers, otherwise as
+   *             strings
+   *   ~         the attribute matches the shell glob in the operand
+   *
+   * An array attribute matches if any of its entries does, and for '!='
+   * if none of them is equal to the operand. An attribute that a resource
+   * does not have only matches '!='.
+   */
+  class filter {
+  public:
+    enum class op { eq, ne, lt, le, gt, ge, glob };
+
+    struct predicate {
+      std::string attr;
+      filter::op  oper;
+      std::string operand;
+
+      /* Returns true if the attribute value v meets this predicate */
+      bool matches(const value& v) const;
+
+      /* The name of the operator, like ">=" */
+      const std::string& op_name() const;
+
+      /* The predicate in the form that parse accepts */
+      std::string to_string() const;
+    };
+
+    /**
+     * Creates the filter that matches everything
+     */
+    filter() { }
+
+    /**
+     * Parses the filter whose predicates are \p exprs
+     */
+    static result<filter> parse(const std::vector<std::string>& exprs);
+
+    /**
+     * Parses a single predicate like 'uid>=1000'
+     */
+    static result<predicate> parse_predicate(const std::string& expr);
+
+    /**
+     * Returns true if this filter matches everything
+     */
+    bool empty() const { return _preds.empty(); }
+
+    const std::vector<predicate>& predicates() const { return _preds; }
+
+    /**
+     * Returns true if the attribute \p attr appears in any predicate
+     */
+    bool mentions(const std::string& attr) const;
+
+    /**
+     * Returns true if \p res matches all predicates
+     */
+    bool matches(const resource& res) const;
+
+    /**
+     * Returns false if \p res can not match this filter, looking only at
+     * the attributes \p res already has. Providers use that to drop
+     * resources before they look up their expensive attributes.
+     */
+    bool admits(const resource& res) const;
+
+    /**
+     * The predicates in the form that parse accepts
+     */
+    std::vector<std::string> to_strings() const;
+
+  private:
+    bool matches(const resource& res, bool partial) const;
+
+    std::vector<predicate> _preds;
+  };
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <unordered_map>
+
 #include <libral/provider.hpp>
 #include <libral/augeas.hpp>
 
@@ -12,16 +14,40 @@ namespace libral {
 
     result<void> set(context &ctx, const updates& upds) override;
 
+    result<boost::optional<token>> state_token() override;
+
+    std::vector<std::string>
+    watch_paths(const std::vector<std::string>& names) const override;
+
   protected:
     result<prov::spec> describe(environment& env) override;
 
   private:
+    /* Create the augeas handle if that has not happened yet, and (re)load
+       the files we manage if they changed */
+    result<void> load();
+
+    /* Match all entries in /etc/hosts and rebuild _paths from them */
+    result<std::vector<augeas::node>> entries();
     result<augeas::node> base(const update &upd);
     result<resource> make(const std::string& name,
                           const augeas::node& base, const std::string& ens);
     result<void> update_base(const update &upd);
     result<void> set(context &ctx, const update &upd);
 
+    /* The environment from describe, kept so that we can create _aug
+       when it is first needed */
+    boost::optional<environment>    _env;
     std::shared_ptr<augeas::handle> _aug;
+    /* Maps each canonical host name to the paths of its entries in the
+       augeas tree; rebuilt whenever we look at all entries, and kept up
+       to date by set */
+    std::unordered_map<std::string, std::vector<std::string>> _paths;
+    /* The augeas generation _paths was built from */
+    boost::optional<augeas::handle::token> _index_gen;
+    /* The resources from the last get, and the augeas generation they
+       were read from */
+    std::vector<resource> _cache;
+    boost::optional<augeas::handle::token> _cache_gen;
   };
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "provider.hpp"
+#include "coprocess.hpp"
 
 #include <leatherman/json_container/json_container.hpp>
 
@@ -12,8 +13,12 @@ namespace libral {
     using json_container = leatherman::json_container::JsonContainer;
     using json_keys = std::vector<leatherman::json_container::JsonContainerKey>;
 
-    json_provider(command::uptr& cmd, prov::spec &spec)
-      : provider(spec), _cmd(std::move(cmd)) { };
+    /* If persistent is true, the provider script is started once and
+       kept running, and all actions are sent to that one process as
+       described in invoke-persistent.md */
+    json_provider(command::uptr& cmd, prov::spec &spec,
+                  bool persistent = false)
+      : provider(spec), _cmd(std::move(cmd)), _persistent(persistent) { };
 
     result<std::vector<resource>>
     get(context& ctx, const std::vector<std::string>& names,
@@ -40,6 +45,16 @@ namespace libral {
                     const json_container& json,
                     const json_keys& key);
 
+    result<std::string>
+    run_persistent(context& ctx,
+                   const std::string& action,
+                   const std::string& inp,
+                   std::function<bool(std::string&)> err_cb);
+
     command::uptr _cmd;
+    bool          _persistent;
+    /* The running provider process when _persistent is true; started
+       lazily on the first action */
+    coprocess::sptr _proc;
   };
 }
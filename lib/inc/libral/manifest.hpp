@@ -0,0 +1,63 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <libral/result.hpp>
+#include <libral/provider.hpp>
+
+namespace libral {
+  /**
+   * The desired state of many resources, possibly of different types, as
+   * 'ralsh --apply' reads it from a JSON document; see
+   * doc/ralsh-apply.md for the format. The resources are grouped by the
+   * provider that manages them.
+   */
+  class manifest {
+  public:
+    /* A provider together with the resources it should change, in the
+     * order in which they are listed in the manifest */
+    using entry = std::pair<std::shared_ptr<provider>, std::vector<resource>>;
+
+    /**
+     * Parses the manifest \p text, looking up the providers for its
+     * resources in \p provs. Returns an error if the text is not valid
+     * JSON, if it mentions an unknown provider or attribute, or if it
+     * lists the same resource more than once.
+     */
+    static result<manifest>
+    parse(const std::string& text,
+          const std::vector<std::shared_ptr<provider>>& provs);
+
+    /**
+     * The providers in the order in which they first appear in the
+     * manifest, with their resources
+     */
+    const std::vector<entry>& entries() const { return _entries; }
+
+    /**
+     * Splits the entries into lanes that can be applied concurrently, and
+     * returns the indices into entries() of each lane in the order in
+     * which the lane's entries must be applied one after the other.
+     *
+     * Two entries end up in the same lane if their providers keep their
+     * state in some of the same files, judging by watch_paths(), or if one
+     * of them has to be applied before the other, as precedes() says.
+     * Otherwise, entries keep the order in which they appear in the
+     * manifest.
+     */
+    std::vector<std::vector<size_t>> lanes() const;
+
+    /**
+     * Returns true if resources of the type \p before must be changed
+     * before those of the type \p after: groups before the users that
+     * belong to them, and packages before the services they install.
+     */
+    static bool precedes(const std::string& before, const std::string& after);
+
+  private:
+    std::vector<entry> _entries;
+  };
+}
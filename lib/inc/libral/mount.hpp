@@ -1,5 +1,8 @@
 #pragma once
 
+#include <map>
+#include <unordered_map>
+
 #include <libral/command.hpp>
 #include <libral/ral.hpp>
 #include <libral/provider.hpp>
@@ -42,22 +45,53 @@ namespace libral {
 
     result<void> set(context &ctx, const updates& upds) override;
 
+    result<boost::optional<token>> state_token() override;
+
+    std::vector<std::string>
+    watch_paths(const std::vector<std::string>& names) const override;
+
   protected:
     result<prov::spec> describe(environment& env) override;
 
   private:
-    augeas::node base(const update &upd);
+    /* Create the augeas handle if that has not happened yet, and (re)load
+       the files we manage if they changed */
+    result<void> load();
+
+    /* Match all entries in /etc/fstab and rebuild _paths from them */
+    result<std::vector<augeas::node>> entries();
+    result<augeas::node> base(const update &upd);
     result<resource> make(const std::string& name,
                           const augeas::node& base, const std::string& ens);
     result<void> update_base(const update &upd);
-    result<void> set(context &ctx, const update &upd);
+    /* Make the changes to fstab that upd needs in the augeas tree, and
+       add its mountpoint to umounts or mounts if it needs to be unmounted
+       or mounted once fstab has been saved */
+    result<void> plan(context &ctx, const update &upd,
+                      std::vector<std::string>& umounts,
+                      std::vector<std::string>& mounts);
     result<void> update_fstab(const update& upd, changes& changes);
     result<void> remove_from_fstab(const update &upd);
-    result<void> unmount(const std::string& name, const std::string& state);
-    result<void> mount(const std::string& name, const std::string& state);
+    result<void> run_by_depth(command& cmd,
+                              const std::vector<std::string>& mountpoints,
+                              const std::map<std::string, std::string>& devices,
+                              bool deepest_first, const limits& lim);
     result<void> flush();
 
+    /* The environment from describe, kept so that we can create _aug
+       when it is first needed */
+    boost::optional<environment>    _env;
     std::shared_ptr<augeas::handle> _aug;
+    /* Maps each mountpoint to the path of its entry in /etc/fstab in the
+       augeas tree; rebuilt whenever we look at all entries, and kept up
+       to date by set */
+    std::unordered_map<std::string, std::string> _paths;
+    /* The augeas generation _paths was built from */
+    boost::optional<augeas::handle::token> _index_gen;
+    /* The resources for the entries in fstab from the last get, and the
+       augeas generation they were read from */
+    std::vector<resource>           _fstab_cache;
+    boost::optional<augeas::handle::token> _fstab_gen;
     command::uptr                   _cmd_mount;
     command::uptr                   _cmd_umount;
   };
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace libral { namespace mountinfo {
+
+  /**
+   * One line from /proc/<pid>/mountinfo, reduced to what the mount
+   * provider needs
+   */
+  struct entry {
+    /** The mount point */
+    std::string mountpoint;
+    /** The mount source, e.g., the device that is mounted */
+    std::string device;
+    /** The filesystem type */
+    std::string fstype;
+    /** The per-mount options, followed by the filesystem's super
+     *  options, as in /proc/mounts */
+    std::string options;
+  };
+
+  /**
+   * Parses text in the format of /proc/<pid>/mountinfo (see proc(5)) and
+   * returns its entries in the order in which they appear. Octal escapes
+   * such as '\040' in paths are decoded. Lines that do not have all the
+   * expected fields are skipped.
+   */
+  std::vector<entry> parse(const std::string& text);
+
+} }
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+namespace libral {
+  /**
+   * Calls fn(i) for every i from 0 to n - 1 on a pool of at most jobs
+   * threads, including the calling thread, and returns once all calls
+   * have finished. With jobs = 0, the pool has one thread per core.
+   *
+   * Every call is made, even if some of them throw; the first exception
+   * that was thrown is rethrown once all calls have finished.
+   */
+  void parallel_for(size_t n, unsigned int jobs,
+                    const std::function<void(size_t)>& fn);
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <set>
+
 #include <boost/optional.hpp>
 
 #include <libral/attr/spec.hpp>
@@ -40,6 +42,29 @@ namespace libral {
 
     const std::string& invoke() const { return _invoke; }
 
+    /**
+     * Returns true if the provider can handle several resources in one
+     * invocation of action, i.e., if action is listed in the 'batch'
+     * entry of its metadata
+     */
+    bool batch(const std::string& action) const {
+      return _batch.find(action) != _batch.end();
+    }
+
+    /**
+     * Returns true if the provider can skip the resources that do not
+     * match a filter when it lists resources, i.e., if its metadata has
+     * 'filter: true'
+     */
+    bool filter() const { return _filter; }
+
+    /**
+     * Returns the number of seconds that running \p action may take
+     * before it is killed, or 0 if there is no limit. This comes from the
+     * 'timeout' entry in the provider's metadata.
+     */
+    unsigned int timeout(const std::string& action) const;
+
     /**
      * Returns true if the provider is suitable, i.e., can be used
      * successfully on this system
@@ -61,6 +86,15 @@ namespace libral {
                              const std::string &yaml,
                              bool suitable);
 
+    /**
+     * Returns the names of the commands that the 'suitable.commands'
+     * entry in the metadata \p yaml checks for, whether it requires them
+     * to be present or absent. This does not validate the metadata; it
+     * returns what it can find, and is meant to look up all commands that
+     * read() will check for ahead of time.
+     */
+    static std::vector<std::string> commands(const std::string& yaml);
+
     attr_spec_map::const_iterator attr_begin() const
       { return _attr_specs.cbegin(); }
     attr_spec_map::const_iterator attr_end() const
@@ -69,7 +103,8 @@ namespace libral {
   private:
     spec(const std::string& name, const std::string& type,
          const std::string& desc, const std::string& invoke,
-         bool suitable,
+         bool suitable, std::set<std::string>&& batch, bool filter,
+         std::map<std::string, unsigned int>&& timeouts,
          attr_spec_map&& attr_specs);
     std::string make_qname(const std::string& name, const std::string& type);
 
@@ -79,6 +114,11 @@ namespace libral {
     std::string   _invoke;
     std::string   _qname;
     bool          _suitable;
+    std::set<std::string> _batch;
+    bool          _filter;
+    /* Timeouts by action name; the entry for 'default' applies to actions
+       that have no entry of their own */
+    std::map<std::string, unsigned int> _timeouts;
 
     attr_spec_map _attr_specs;
   };
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <vector>
 #include <map>
 #include <memory>
@@ -11,6 +12,7 @@
 #include <libral/value.hpp>
 #include <libral/resource.hpp>
 #include <libral/context.hpp>
+#include <libral/filter.hpp>
 #include <libral/environment.hpp>
 #include <libral/prov/spec.hpp>
 
@@ -28,6 +30,12 @@ namespace libral {
   */
   class provider : public std::enable_shared_from_this<provider> {
   public:
+    /**
+     * Identifies the state of the resources a provider manages at some
+     * point in time; see state_token()
+     */
+    using token = uint64_t;
+
     provider() { };
     provider(prov::spec& spec) : _spec(spec) { }
 
@@ -64,16 +72,38 @@ namespace libral {
      * Returns an error if the lookup failed. On success, returns a list of
      * resources that is guaranteed to at least contain the resources
      * mentioned in \p names but may contain more than that.
+     *
+     * Any commands that the provider runs are subject to \p lim: a
+     * nonzero timeout overrides the timeouts in the provider's metadata,
+     * and cancelling lim.cancel from another thread stops them, which
+     * makes this return an error.
+     *
+     * If \p attrs is not empty, the returned resources only have those
+     * attributes, besides their name and ensure; providers use that to
+     * skip computing attributes that are expensive to look up. Asking for
+     * or filtering on an attribute the provider does not have is an
+     * error.
+     *
+     * Only resources that match \p filt are returned. Builtin providers
+     * check the filter before they look up everything about a resource,
+     * and external providers that declare 'filter: true' in their
+     * metadata are given the filter to do the same.
      */
     result<std::vector<resource>>
-    get(const std::vector<std::string>& names = { });
+    get(const std::vector<std::string>& names = { },
+        const limits& lim = limits(),
+        const std::vector<std::string>& attrs = { },
+        const filter& filt = filter());
 
     /**
      * Returns the current state of the resource NAME if it exists, and
      * boost::none if there is no such resource. Returns an error if more
-     * than one resource NAME exist.
+     * than one resource NAME exist. \p lim and \p attrs have the same
+     * meaning as for get.
      */
-    result<boost::optional<resource>> find(const std::string &name);
+    result<boost::optional<resource>>
+    find(const std::string &name, const limits& lim = limits(),
+         const std::vector<std::string>& attrs = { });
 
     /**
      * Sets the resources to the desired state indicated in \p should. For
@@ -85,12 +115,38 @@ namespace libral {
      * Returns an \p error if any change fails. If all changes succeed,
      * returns the updates, i.e. the pairs of is/should state that was
      * passed to the provider, and the changes that were actually performed
-     * as reported by the provider.
+     * as reported by the provider. \p lim has the same meaning as for
+     * get.
      */
     result<std::vector<std::pair<update, changes>>>
-    set(const std::vector<resource>& shoulds);
+    set(const std::vector<resource>& shoulds, const limits& lim = limits());
 
 
+    /**
+     * Returns a token for the current state of the resources this provider
+     * manages, or boost::none if the provider has no cheap way of telling
+     * when that state changes. The default implementation returns
+     * boost::none.
+     */
+    virtual result<boost::optional<token>> state_token();
+
+    /**
+     * Returns true if nothing has changed since \p tok was returned by
+     * state_token(). This is much cheaper than a get for providers that
+     * support it, and always returns false for providers that don't.
+     */
+    result<bool> unchanged_since(token tok);
+
+    /**
+     * Returns the files on the local system that hold the state of the
+     * resources \p names, or of all resources if \p names is empty, so
+     * that a watcher can tell when they might have changed. The default
+     * implementation returns no files, which means that the provider can
+     * not be watched.
+     */
+    virtual std::vector<std::string>
+    watch_paths(const std::vector<std::string>& names) const;
+
     /**
      * Reads the string representation v for attribute name and returns the
      * corresponding value. If v is not a valid string for name's type,
@@ -7,6 +7,7 @@
 #include <libral/result.hpp>
 #include <libral/provider.hpp>
 #include <libral/environment.hpp>
+#include <libral/watch.hpp>
 
 namespace libral {
   class ral : public std::enable_shared_from_this<ral> {
@@ -15,6 +16,13 @@ namespace libral {
     boost::optional<std::shared_ptr<provider>>
     find_provider(const std::string& name);
 
+    /* Look up the provider \p name amongst \p provs, which usually is the
+     * result of an earlier call to providers(); this makes it possible to
+     * keep providers around across lookups */
+    static boost::optional<std::shared_ptr<provider>>
+    find_provider(const std::string& name,
+                  const std::vector<std::shared_ptr<provider>>& provs);
+
     /* Create an instance of the RAL */
     static std::shared_ptr<ral> create(std::vector<std::string> data_dirs);
 
@@ -26,6 +34,16 @@ namespace libral {
 
     const std::vector<std::string>& data_dirs() const { return _data_dirs; }
 
+    /* Set the limits for running external providers to find out what
+     * they can do while discovering providers. By default, there are no
+     * limits */
+    void set_describe_limits(const limits& lim) { _describe_limits = lim; }
+
+    /* Create a watcher that reports changes to the resources of
+     * providers as they happen. Watching only works for the local
+     * system, not when connected to a remote target */
+    result<watcher::uptr> watch();
+
     boost::optional<std::string>
     find_in_data_dirs(const std::string& file) const;
 
@@ -50,5 +68,6 @@ namespace libral {
     std::vector<std::string> _data_dirs;
     target::sptr _target;
     bool _local;
+    limits _describe_limits;
   };
 }
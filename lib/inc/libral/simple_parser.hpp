@@ -0,0 +1,23 @@
+#pragma once
+
+#include <boost/utility/string_ref.hpp>
+
+namespace libral {
+  /**
+   * Splits the output of a provider that follows the 'simple' calling
+   * convention into keys and values without copying them. The key and
+   * value point into the line they came from; the only copies are the
+   * ones that end up in the resource.
+   */
+  class simple_parser {
+  public:
+    using string_ref = boost::string_ref;
+
+    /**
+     * Splits line into key and value at the first ':'. Leading and
+     * trailing whitespace is removed from the line and from the
+     * value. Returns false if line does not contain a ':'
+     */
+    static bool split(string_ref line, string_ref& key, string_ref& value);
+  };
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "provider.hpp"
+#include "simple_parser.hpp"
 
 namespace libral {
   /* A provider backed by an executable that follows the 'simple' calling
@@ -22,10 +23,28 @@ namespace libral {
     result<std::vector<resource>> find(context& ctx, const std::string &name);
     result<std::vector<resource>> instances(context& ctx);
 
+    /* Look up all names with one invocation of the script; used when the
+       provider declares 'batch: [find]' */
+    result<std::vector<resource>>
+    find_batch(context& ctx, const std::vector<std::string>& names);
+
+    /* Perform all updates with one invocation of the script; used when
+       the provider declares 'batch: [update]' */
+    result<void> set_batch(context &ctx, const updates& upds);
+
+    /* Set attribute key of rsrc to value */
+    void set_attr(resource& rsrc, simple_parser::string_ref key,
+                  simple_parser::string_ref value);
+
+    /* Run the script for action and call entry_cb with the key and value
+       of each line of output; the key and value point into the line
+       buffer and are only valid during the call. If stdin is not null,
+       pass it to the script on its standard input */
+    template<typename F>
     result<bool>
-    run_action(context& ctx, const std::string& action,
-               std::function<result<bool>(std::string&, std::string&)> entry_cb,
-               std::vector<std::string> args = {});
+    run_action(context& ctx, const std::string& action, F entry_cb,
+               std::vector<std::string> args = {},
+               const std::string *stdin = nullptr);
 
     command::uptr _cmd;
   };
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <libral/result.hpp>
+#include <libral/provider.hpp>
+
+namespace libral {
+  /**
+   * The state of the resources of some providers at one point in time, in
+   * a compact format that can be written to a file and compared against
+   * another snapshot quickly.
+   *
+   * A snapshot file starts with a header, followed by one record for each
+   * resource and an index of the records, which is sorted by provider and
+   * resource name. All integers are little-endian, and a str is a u32
+   * length followed by that many bytes:
+   *
+   *   header: "RALSNAP\0", u32 version, u32 record count, u64 index offset
+   *   record: str type, str provider, str name, str attributes
+   *   index:  u64 offset of each record
+   *
+   * The attributes of a record are a u32 count, followed by the name
+   * (a str), a u8 tag and the value of each attribute, sorted by
+   * name. Since that makes the attributes of two resources in the same
+   * state identical byte for byte, comparing snapshots only needs to
+   * decode the attributes of resources that changed.
+   *
+   * Snapshot files are mapped into memory rather than read.
+   */
+  class snapshot {
+  public:
+    using uptr = std::unique_ptr<snapshot>;
+
+    /* The version of the file format that we read and write */
+    static const uint32_t version = 1;
+
+    /**
+     * Collects the resources for a new snapshot
+     */
+    class builder {
+    public:
+      /* Add rsrcs, which all belong to prov. A resource replaces one
+       * with the same provider and name that was added earlier */
+      void add(const provider& prov, const std::vector<resource>& rsrcs);
+
+      /* The snapshot of everything that was added so far */
+      uptr build() const;
+
+      /* Write the snapshot of everything that was added so far to path,
+       * replacing whatever was there atomically */
+      result<void> write(const std::string& path) const;
+
+    private:
+      std::string bytes() const;
+
+      struct entry {
+        std::string provider;
+        std::string name;
+        /* The encoded record */
+        std::string record;
+      };
+      std::vector<entry> _entries;
+    };
+
+    /**
+     * A resource that is not the same in two snapshots
+     */
+    struct difference {
+      enum class state { added, removed, changed };
+
+      state what;
+      std::string type;
+      std::string provider;
+      std::string name;
+      /* The attributes that differ, with their value in the newer
+       * snapshot as is and in the older one as was. For added and removed
+       * resources, these are all their attributes */
+      std::vector<change> chgs;
+    };
+
+    ~snapshot();
+
+    /* Open the snapshot file path */
+    static result<uptr> open(const std::string& path);
+
+    /* The number of resources in the snapshot */
+    size_t size() const { return _count; }
+
+    /* The qualified names of the providers that have resources in the
+     * snapshot, in sorted order */
+    std::vector<std::string> providers() const;
+
+    /* The differences between the older snapshot from and the newer
+     * snapshot to, sorted by provider and resource name */
+    static std::vector<difference> diff(const snapshot& from,
+                                        const snapshot& to);
+
+  private:
+    /* A string inside the snapshot's data */
+    struct str {
+      const char *data;
+      uint32_t    len;
+    };
+
+    struct record {
+      str type;
+      str provider;
+      str name;
+      str attrs;
+    };
+
+    snapshot() { }
+
+    /* Check that _data is a well-formed snapshot */
+    result<void> init();
+
+    /* The i-th record in index order; init() must have succeeded */
+    record at(size_t i) const;
+
+    /* Bytes of snapshots that were built in memory */
+    std::string  _bytes;
+    /* The mapping of snapshots that were read from a file */
+    void        *_map = nullptr;
+    size_t       _map_len = 0;
+
+    const char  *_data = nullptr;
+    size_t       _len = 0;
+    uint32_t     _count = 0;
+    const char  *_index = nullptr;
+  };
+}
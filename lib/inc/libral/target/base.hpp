@@ -1,13 +1,22 @@
 #pragma once
 
+#include <map>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 #include <libral/result.hpp>
 #include <libral/command.hpp>
 #include <libral/augeas.hpp>
+#include <libral/coprocess.hpp>
 
 namespace libral {
   namespace target {
+  /**
+   * A system on which providers do their work. Targets can be used from
+   * several threads at once, for example to run the get actions of
+   * different providers concurrently.
+   */
   class base : public std::enable_shared_from_this<base> {
   public:
     virtual ~base() = default;
@@ -39,6 +48,9 @@ namespace libral {
      * what files: for each transformation (pair), the first element names
      * a lens like Hosts.lns and the second is the absolute path to a
      * file. Note that globs in filenames are currently not supported.
+     *
+     * Implementations may return the same handle for repeated calls with
+     * the same xfms, reloading it on each call.
      */
     virtual result<std::shared_ptr<augeas::handle>>
     augeas(const std::vector<std::pair<std::string, std::string>>& xfms) = 0;
@@ -50,9 +62,25 @@ namespace libral {
 
     /**
      * Returns the absolute path to the command cmd. If the command does
-     * not exist, returns an empty string.
+     * not exist, returns an empty string. Results are cached until
+     * forget_commands() is called.
      */
-    virtual std::string which(const std::string& cmd) = 0;
+    std::string which(const std::string& cmd);
+
+    /**
+     * Looks up all of cmds at once and caches the results, so that later
+     * calls to which() for any of them do not have to consult the target.
+     */
+    void which_all(const std::vector<std::string>& cmds);
+
+    /**
+     * Forgets all cached command paths, for example because commands might
+     * have been installed or removed since they were looked up.
+     */
+    void forget_commands() {
+      std::lock_guard<std::mutex> lock(_which_mutex);
+      _which.clear();
+    }
 
     /**
      * Uploads the local file cmd to a temporary directory and makes it
@@ -63,12 +91,40 @@ namespace libral {
 
     /**
      * Executes the file cmd, passing the command line arguments args and,
-     * optionally, *stdin on stdin. The file cmd must already exist on the
-     * target and be executable.
+     * if it is not null, *stdin on stdin. The file cmd must already exist
+     * on the target and be executable.
+     *
+     * This and the other methods that run commands enforce lim: they kill
+     * the command when it takes longer than lim.timeout, or when
+     * lim.cancel is cancelled, and report that in the error member of the
+     * result.
+     */
+    virtual command::result execute(const std::string& cmd,
+                                    const std::vector<std::string>& args,
+                                    const std::string *stdin,
+                                    const limits& lim) = 0;
+
+    /**
+     * Executes the file cmd, passing the command line arguments args and
+     * stdin on its standard input. While the command is running, calls
+     * out_cb and err_cb on each line of its stdout and stderr. The output
+     * and error members of the returned result are always empty.
      */
     virtual command::result execute(const std::string& cmd,
                                     const std::vector<std::string>& args,
-                                    const std::string *stdin = nullptr) = 0;
+                                    const std::string& stdin,
+                                    std::function<bool(std::string&)> out_cb,
+                                    std::function<bool(std::string&)> err_cb,
+                                    const limits& lim) = 0;
+
+    /**
+     * Starts the file cmd with the command line arguments args as a
+     * coprocess that keeps running until the returned object is
+     * destroyed. The file cmd must already exist on the target and be
+     * executable.
+     */
+    virtual result<coprocess::sptr>
+    spawn(const std::string& cmd, const std::vector<std::string>& args) = 0;
 
     /**
      * Executes the file cmd, passing the command line arguments
@@ -78,7 +134,8 @@ namespace libral {
     virtual bool each_line(const std::string& cmd,
                            std::vector<std::string> const& args,
                            std::function<bool(std::string&)> out_cb,
-                           std::function<bool(std::string&)> err_cb) = 0;
+                           std::function<bool(std::string&)> err_cb,
+                           const limits& lim) = 0;
 
     /**
      * Reads a file from the absolute path remote_path on the target and
@@ -93,6 +150,42 @@ namespace libral {
      */
     virtual result<void> write(const std::string& content,
                                const std::string& remote_path) = 0;
+
+  protected:
+    /**
+     * Runs the local executable file with args, passing *stdin on its
+     * standard input if stdin is not null, and enforces lim. If out_cb
+     * and err_cb are null, the output is collected in the result;
+     * otherwise, they are called for each line of output.
+     *
+     * If own_group is true, file is run in a new session so that
+     * everything it starts is killed together with it. That also
+     * detaches it from our terminal, which is not acceptable for commands
+     * like ssh that might need to ask for a password. Such a child does
+     * not get the SIGINT from Ctrl-C either; callers that want it to stop
+     * on one have to cancel lim.cancel, as ralsh does.
+     */
+    static command::result
+    run_limited(const std::string& file,
+                const std::vector<std::string>& args,
+                const std::string *stdin,
+                std::function<bool(std::string&)> out_cb,
+                std::function<bool(std::string&)> err_cb,
+                const limits& lim, bool own_group);
+
+    /**
+     * Looks up the absolute paths of cmds on the target, returning them in
+     * the same order as cmds, with an empty string for commands that do
+     * not exist. Targets should do that with as few round trips as they
+     * can.
+     */
+    virtual std::vector<std::string>
+    lookup_commands(const std::vector<std::string>& cmds) = 0;
+
+  private:
+    /* Protects _which */
+    std::mutex _which_mutex;
+    std::map<std::string, std::string> _which;
   };
   }
 }
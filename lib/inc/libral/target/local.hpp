@@ -1,5 +1,8 @@
 #pragma once
 
+#include <map>
+#include <mutex>
+
 #include <libral/target/base.hpp>
 
 namespace libral {
@@ -17,24 +20,48 @@ namespace libral {
 
     bool executable(const std::string& file) override;
 
-    std::string which(const std::string& cmd) override;
-
     result<std::string> upload(const std::string& cmd) override;
 
     command::result execute(const std::string& cmd,
                             const std::vector<std::string>& args,
-                            const std::string *stdin = nullptr) override;
+                            const std::string *stdin,
+                            const limits& lim) override;
+
+    command::result execute(const std::string& cmd,
+                            const std::vector<std::string>& args,
+                            const std::string& stdin,
+                            std::function<bool(std::string&)> out_cb,
+                            std::function<bool(std::string&)> err_cb,
+                            const limits& lim) override;
+
+    result<coprocess::sptr>
+    spawn(const std::string& cmd,
+          const std::vector<std::string>& args) override;
 
     bool each_line(const std::string& cmd,
                    std::vector<std::string> const& args,
                    std::function<bool(std::string&)> out_cb,
-                   std::function<bool(std::string&)> err_cb) override;
+                   std::function<bool(std::string&)> err_cb,
+                   const limits& lim) override;
 
     result<std::string> read(const std::string& remote_path) override;
 
     result<void> write(const std::string& content,
                        const std::string& remote_path) override;
 
+  protected:
+    std::vector<std::string>
+    lookup_commands(const std::vector<std::string>& cmds) override;
+
+  private:
+    using xfm_list = std::vector<std::pair<std::string, std::string>>;
+
+    /* Augeas handles that we have created, keyed by their transforms. We
+       hand out the same handle every time augeas() is called with the
+       same transforms; that handle is not safe to use from several
+       threads at once */
+    std::mutex _augeas_mutex;
+    std::map<xfm_list, std::shared_ptr<augeas::handle>> _augeas;
   };
   }
 }
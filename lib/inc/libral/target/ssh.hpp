@@ -23,35 +23,57 @@ namespace libral {
 
     bool executable(const std::string& file) override;
 
-    std::string which(const std::string& cmd) override;
-
     result<std::string> upload(const std::string& cmd) override;
 
     command::result execute(const std::string& cmd,
                             const std::vector<std::string>& args,
-                            const std::string *stdin = nullptr) override;
+                            const std::string *stdin,
+                            const limits& lim) override;
+
+    command::result execute(const std::string& cmd,
+                            const std::vector<std::string>& args,
+                            const std::string& stdin,
+                            std::function<bool(std::string&)> out_cb,
+                            std::function<bool(std::string&)> err_cb,
+                            const limits& lim) override;
+
+    result<coprocess::sptr>
+    spawn(const std::string& cmd,
+          const std::vector<std::string>& args) override;
 
     bool each_line(const std::string& cmd,
                    std::vector<std::string> const& args,
                    std::function<bool(std::string&)> out_cb,
-                   std::function<bool(std::string&)> err_cb) override;
+                   std::function<bool(std::string&)> err_cb,
+                   const limits& lim) override;
 
     result<std::string> read(const std::string& remote_path) override;
 
     result<void> write(const std::string& content,
                        const std::string& remote_path) override;
 
+  protected:
+    std::vector<std::string>
+    lookup_commands(const std::vector<std::string>& cmds) override;
+
   private:
     result<std::string> tmpdir();
 
+    /* How long we wait for the housekeeping commands that we run on the
+       target ourselves, like copying files or creating directories */
+    static const unsigned int housekeeping_timeout = 20;
+
     command::result run(const std::string& file,
                         const std::vector<std::string>& args,
-                        const std::string *stdin = nullptr);
+                        const std::string *stdin = nullptr,
+                        const limits& lim = limits(housekeeping_timeout));
 
     command::result run_ssh(const std::vector<std::string>& args,
                             const std::string *stdin = nullptr);
 
     std::string _target;
+    /* Protects _tmpdir, which gets created on first use */
+    std::mutex _tmpdir_mutex;
     std::string _tmpdir;
     bool _sudo;
     bool _keep;
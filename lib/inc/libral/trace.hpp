@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace libral {
+  /**
+   * Lightweight instrumentation of the expensive things libral does:
+   * discovering providers, running provider actions and commands, moving
+   * files to and from targets and loading and saving files with Augeas.
+   *
+   * Code marks such an operation by putting a span on the stack for its
+   * duration. Tracing is off by default; while it is off, a span does
+   * nothing besides checking a flag. Once tracing has been turned on with
+   * enable(), every span that ends is recorded and the recorded events
+   * can be summarized or written as a trace file.
+   */
+  namespace trace {
+
+    using clock = std::chrono::steady_clock;
+
+    /**
+     * A span that has ended
+     */
+    struct event {
+      /* What was done, e.g. "provider.get" */
+      const char *name;
+      /* What it was done to, e.g. the provider's qualified name */
+      std::string detail;
+      clock::time_point start;
+      clock::duration duration;
+      /* A small number identifying the thread the span ran in */
+      unsigned int thread;
+    };
+
+    namespace impl {
+      extern std::atomic<bool> s_enabled;
+      void record(const char *name, std::string&& detail,
+                  clock::time_point start);
+    }
+
+    /**
+     * Turn recording of spans on or off. Turning it on does not discard
+     * events that have been recorded already.
+     */
+    void enable(bool on = true);
+
+    inline bool enabled() {
+      return impl::s_enabled.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Returns a copy of all events recorded so far, in the order in which
+     * they ended
+     */
+    std::vector<event> events();
+
+    /**
+     * Discards all recorded events
+     */
+    void clear();
+
+    /**
+     * Writes a human readable summary of the recorded events to \p out:
+     * how often each kind of span occurred for each detail, and how much
+     * time was spent in it, with the most expensive ones first
+     */
+    void write_summary(std::ostream& out);
+
+    /**
+     * Writes the recorded events in the Chrome trace event format to \p
+     * out. The result can be loaded into chrome://tracing or Perfetto
+     */
+    void write_chrome(std::ostream& out);
+
+    /**
+     * Records the time from its construction to its destruction as an
+     * event, if tracing is enabled. \p name must be a string literal
+     */
+    class span {
+    public:
+      explicit span(const char *name) : _name(name) {
+        if (enabled())
+          _start = clock::now();
+      }
+
+      span(const char *name, const std::string& detail) : _name(name) {
+        if (enabled()) {
+          _detail = detail;
+          _start = clock::now();
+        }
+      }
+
+      ~span() {
+        if (_start != clock::time_point())
+          impl::record(_name, std::move(_detail), _start);
+      }
+
+      span(const span&) = delete;
+      span& operator=(const span&) = delete;
+
+    private:
+      const char *_name;
+      std::string _detail;
+      clock::time_point _start;
+    };
+  }
+}
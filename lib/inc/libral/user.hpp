@@ -52,6 +52,9 @@ namespace libral {
     result<void>
     set(context &ctx, const updates& upds) override;
 
+    std::vector<std::string>
+    watch_paths(const std::vector<std::string>& names) const override;
+
   protected:
     result<prov::spec> describe(environment &env) override;
   private:
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include <libral/result.hpp>
+#include <libral/provider.hpp>
+#include <libral/snapshot.hpp>
+#include <libral/cancellation.hpp>
+
+namespace libral {
+  /**
+   * Reports how the resources of some providers change, without having to
+   * poll them. The watcher asks each provider for the files that hold the
+   * state of its resources (see provider::watch_paths) and waits for the
+   * kernel to tell it that one of them changed; only then does it run the
+   * get action of the providers that use that file and compare their
+   * resources with the ones it saw last.
+   *
+   * Files are watched with inotify, and the mount table in /proc with
+   * poll(2), which means that watching only works for the local system,
+   * and only on Linux.
+   *
+   * A watcher must only be used from one thread, except for stop(), which
+   * can be called from any thread.
+   */
+  class watcher {
+  public:
+    using uptr = std::unique_ptr<watcher>;
+
+    /**
+     * Called with a provider whose resources changed, and the
+     * differences between the resources the last time we looked and now,
+     * or the error that getting them produced. Returning false stops
+     * watching.
+     */
+    using callback =
+      std::function<bool(const provider& prov,
+                         const result<std::vector<snapshot::difference>>& deltas)>;
+
+    ~watcher();
+
+    /**
+     * Starts watching the resources \p names of \p prov, or all its
+     * resources if \p names is empty. This gets the resources once, so
+     * that later changes can be reported relative to them. \p lim applies
+     * to all calls of the provider's get action.
+     */
+    result<void> add(const std::shared_ptr<provider>& prov,
+                     const std::vector<std::string>& names = { },
+                     const limits& lim = limits());
+
+    /**
+     * Waits at most \p timeout milliseconds, or forever if \p timeout is
+     * negative, for watched files to change, and calls \p cb for each
+     * provider whose resources changed. Returns false if \p cb asked to
+     * stop or stop() was called, and true otherwise.
+     */
+    result<bool> wait(const callback& cb, int timeout = -1);
+
+    /**
+     * Calls wait() until \p cb asks to stop or stop() is called
+     */
+    result<void> run(const callback& cb);
+
+    /**
+     * Makes a wait() that is in progress in another thread, or the next
+     * one, return false
+     */
+    void stop();
+
+  protected:
+    friend class ral;
+
+    static result<uptr> create();
+
+  private:
+    /* A provider that is being watched */
+    struct watched {
+      std::shared_ptr<provider>        prov;
+      std::vector<std::string>         names;
+      std::vector<std::string>         paths;
+      limits                           lim;
+      /* The resources the last time we looked */
+      snapshot::uptr                   last;
+      boost::optional<provider::token> token;
+    };
+
+    watcher() { }
+
+    /* Gets the current resources of w and returns how they differ from
+     * the last ones */
+    result<std::vector<snapshot::difference>> refresh(watched& w);
+
+    /* Reads all pending inotify events and marks the watched providers
+     * that use the files they mention */
+    void read_events(std::vector<bool>& dirty);
+
+    int _inotify = -1;
+    /* /proc/self/mountinfo, opened if anything watches it */
+    int _mountinfo = -1;
+    /* Written to by stop() */
+    int _wake[2] = { -1, -1 };
+    /* The directory for each inotify watch descriptor */
+    std::map<int, std::string> _dirs;
+    std::vector<watched> _watched;
+  };
+}
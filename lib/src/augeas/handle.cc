@@ -1,7 +1,11 @@
 #include <libral/augeas.hpp>
+#include <libral/trace.hpp>
 
 #include <sstream>
 
+#include <glob.h>
+#include <sys/stat.h>
+
 #include <boost/nowide/iostream.hpp>
 
 #include <leatherman/locale/locale.hpp>
@@ -11,7 +15,9 @@ using namespace leatherman::locale;
 namespace libral { namespace augeas {
 
   handle::handle(const callback& reader, const callback &writer)
-    : _reader(reader), _writer(writer) {
+    : _seq(0), _reader(reader), _writer(writer),
+      _local(reader == nullptr && writer == nullptr),
+      _dirty(false), _generation(0) {
     // We do not report errors from aug_init. That's bad. Very bad.
 
     // If we have a reader or writer, make sure we can't possibly read or
@@ -20,6 +26,17 @@ namespace libral { namespace augeas {
       ? "/dev/null" : NULL;
     _augeas = aug_init(root, nullptr, AUG_NO_MODL_AUTOLOAD);
 
+    // Find out where the files we load really are, so that we can check
+    // them for changes
+    const char *aug_root = nullptr;
+    if (_local && aug_get(_augeas, "/augeas/root", &aug_root) == 1
+        && aug_root != nullptr) {
+      _root = aug_root;
+      while (! _root.empty() && _root.back() == '/') {
+        _root.pop_back();
+      }
+    }
+
     // Set up default reader and writer
     if (_reader == nullptr) {
       _reader = [this](::augeas *aug) { aug_load(aug); };
@@ -32,16 +49,82 @@ namespace libral { namespace augeas {
   result<void>
   handle::include(const std::string& lens, const std::string& glob) {
     aug_transform(_augeas, lens.c_str(), glob.c_str(), 0);
+    _files.push_back(glob);
+    // Make sure the next load actually reads the new file
+    _prints.clear();
     return check_error();
   }
 
+  static bool operator==(const struct timespec& a, const struct timespec& b) {
+    return a.tv_sec == b.tv_sec && a.tv_nsec == b.tv_nsec;
+  }
+
+  bool handle::fingerprint::operator==(const fingerprint& other) const {
+    return dev == other.dev && ino == other.ino
+      && mtime == other.mtime && ctime == other.ctime
+      && size == other.size;
+  }
+
+  std::vector<handle::fingerprint> handle::fingerprints() const {
+    static const fingerprint missing = { 0, 0, { 0, 0 }, { 0, 0 }, -1 };
+
+    std::vector<fingerprint> prints;
+    for (const auto& file : _files) {
+      // Includes can be globs like /etc/fstab.d/*; fingerprint every
+      // file they match, in sorted order, so that adding or removing a
+      // file counts as a change, too
+      auto pattern = _root + file;
+      glob_t gl;
+      if (glob(pattern.c_str(), 0, nullptr, &gl) != 0) {
+        prints.push_back(missing);
+        globfree(&gl);
+        continue;
+      }
+      for (size_t i = 0; i < gl.gl_pathc; i++) {
+        struct stat st;
+        if (stat(gl.gl_pathv[i], &st) == 0) {
+          prints.push_back({ st.st_dev, st.st_ino, st.st_mtim, st.st_ctim,
+                             st.st_size });
+        } else {
+          prints.push_back(missing);
+        }
+      }
+      globfree(&gl);
+    }
+    return prints;
+  }
+
+  bool handle::changed_on_disk() const {
+    if (! _local || _prints.empty())
+      return true;
+    return ! (fingerprints() == _prints);
+  }
+
   result<void> handle::load(void) {
-    _reader(this->_augeas);
-    return check_error();
+    if (! _dirty && ! changed_on_disk()) {
+      return result<void>();
+    }
+
+    // Take the fingerprints before loading, so that a change while we
+    // load is caught by the next load
+    auto prints = _local ? fingerprints() : std::vector<fingerprint>();
+    {
+      trace::span span("augeas.load");
+      _reader(this->_augeas);
+    }
+    err_ret( check_error() );
+
+    _prints = std::move(prints);
+    _dirty = false;
+    _generation += 1;
+    return result<void>();
   }
 
   result<void> handle::save(void) {
-    _writer(this->_augeas);
+    {
+      trace::span span("augeas.save");
+      _writer(this->_augeas);
+    }
 
     auto r = check_error();
     if (!r) return r;
@@ -99,6 +182,13 @@ namespace libral { namespace augeas {
       }
       return error(os.str());
     }
+
+    // The files on disk now match the tree
+    if (_local) {
+      _prints = fingerprints();
+    }
+    _dirty = false;
+    _generation += 1;
     return result<void>();
   }
 
@@ -121,16 +211,19 @@ namespace libral { namespace augeas {
 
   result<void>
   handle::set(const std::string& path, const std::string& value) {
+    _dirty = true;
     aug_set(_augeas, path.c_str(), value.c_str());
     return check_error();
   }
 
   result<void> handle::clear(const std::string& path) {
+    _dirty = true;
     aug_set(_augeas, path.c_str(), NULL);
     return check_error();
   }
 
   result<void> handle::rm(const std::string& path) {
+    _dirty = true;
     aug_rm(_augeas, path.c_str());
     return check_error();
   }
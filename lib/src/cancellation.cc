@@ -0,0 +1,38 @@
+#include <libral/cancellation.hpp>
+
+#include <signal.h>
+
+namespace libral {
+
+  void cancellation::kill(pid_t pid) {
+    // Children that lead their own process group take everything they
+    // started with them; for others, killing -pid fails and we fall back
+    // to killing just the child
+    if (::kill(-pid, SIGKILL) != 0) {
+      ::kill(pid, SIGKILL);
+    }
+  }
+
+  void cancellation::cancel() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _cancelled.store(true);
+    for (auto pid : _pids) {
+      kill(pid);
+    }
+  }
+
+  bool cancellation::attach(pid_t pid) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_cancelled.load()) {
+      kill(pid);
+      return false;
+    }
+    _pids.insert(pid);
+    return true;
+  }
+
+  void cancellation::detach(pid_t pid) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _pids.erase(pid);
+  }
+}
@@ -1,9 +1,20 @@
 #include <libral/command.hpp>
 
 #include <libral/target/base.hpp>
+#include <libral/trace.hpp>
+
+#include <leatherman/locale/locale.hpp>
+
+using namespace leatherman::locale;
 
 namespace libral {
 
+  static command::result cancelled(const std::string& cmd) {
+    return command::result(false, "",
+                           _("{1} was not run since it was cancelled", cmd),
+                           -1);
+  }
+
   bool command::executable() {
     auto ret = upload();
     if (! ret)
@@ -11,10 +22,11 @@ namespace libral {
     return _tgt->executable(_cmd);
   }
 
-  result<void> command::run(const std::vector<std::string> &args) {
+  result<void> command::run(const std::vector<std::string> &args,
+                            const limits& lim) {
     err_ret( upload() );
 
-    auto status = _tgt->execute(_cmd, args);
+    auto status = execute(args, lim);
 
     if (status.success)
       return libral::result<void>();
@@ -35,36 +47,68 @@ namespace libral {
     }
   }
 
-  command::result command::execute(const std::vector<std::string>& args) {
+  command::result command::execute(const std::vector<std::string>& args,
+                                   const limits& lim) {
     auto res = upload();
     if (!res) {
       return command::result(false, "Upload failed", res.err().detail, 1);
     }
-    return _tgt->execute(_cmd, args);
+    if (lim.cancelled())
+      return cancelled(_cmd);
+    trace::span span("command.execute", _cmd);
+    return _tgt->execute(_cmd, args, nullptr, lim);
   }
 
 
   command::result command::execute(const std::vector<std::string>& args,
-                                         const std::string& stdin) {
+                                   const std::string& stdin,
+                                   const limits& lim) {
+    auto res = upload();
+    if (!res) {
+      return command::result(false, "Upload failed", res.err().detail, 1);
+    }
+    if (lim.cancelled())
+      return cancelled(_cmd);
+    trace::span span("command.execute", _cmd);
+    return _tgt->execute(_cmd, args, &stdin, lim);
+  }
+
+  command::result command::execute(const std::vector<std::string>& args,
+                                   const std::string& stdin,
+                                   std::function<bool(std::string&)> out_cb,
+                                   std::function<bool(std::string&)> err_cb,
+                                   const limits& lim) {
     auto res = upload();
     if (!res) {
       return command::result(false, "Upload failed", res.err().detail, 1);
     }
-    return _tgt->execute(_cmd, args, &stdin);
+    if (lim.cancelled())
+      return cancelled(_cmd);
+    trace::span span("command.execute", _cmd);
+    return _tgt->execute(_cmd, args, stdin, out_cb, err_cb, lim);
+  }
+
+  result<coprocess::sptr>
+  command::spawn(const std::vector<std::string>& args) {
+    err_ret( upload() );
+    return _tgt->spawn(_cmd, args);
   }
 
   bool command::each_line(std::vector<std::string> const& args,
          std::function<bool(std::string&)> out_cb,
-         std::function<bool(std::string&)> err_cb) {
+         std::function<bool(std::string&)> err_cb,
+         const limits& lim) {
     auto res = upload();
-    if (!res) {
+    if (!res || lim.cancelled()) {
       return false;
     }
-    return _tgt->each_line(_cmd, args, out_cb, err_cb);
+    trace::span span("command.execute", _cmd);
+    return _tgt->each_line(_cmd, args, out_cb, err_cb, lim);
   }
 
   libral::result<void> command::upload() {
     if (_needs_upload) {
+      trace::span span("target.upload", _cmd);
       auto abs_cmd = _tgt->upload(_cmd);
       err_ret( abs_cmd );
       _cmd = abs_cmd.ok();
@@ -2,6 +2,8 @@
 
 #include <libral/provider.hpp>
 
+#include <algorithm>
+
 #include <boost/algorithm/string.hpp>
 #include <leatherman/logging/logging.hpp>
 
@@ -97,6 +99,32 @@ namespace libral {
     return (it != _changes.end());
   }
 
+  libral::limits context::limits_for(const std::string& action) const {
+    auto timeout = _limits.timeout;
+    if (timeout == 0 && _prov->spec()) {
+      timeout = _prov->spec()->timeout(action);
+    }
+    return libral::limits(timeout, _limits.cancel);
+  }
+
+  std::vector<std::string> context::wanted_attrs() const {
+    if (_attrs.empty())
+      return _attrs;
+    auto result = _attrs;
+    for (const auto& pred : _filter.predicates()) {
+      if (std::find(result.begin(), result.end(), pred.attr) == result.end())
+        result.push_back(pred.attr);
+    }
+    return result;
+  }
+
+  bool context::wants(const std::string& attr) const {
+    if (_attrs.empty() || attr == "name" || attr == "ensure"
+        || _filter.mentions(attr))
+      return true;
+    return std::find(_attrs.begin(), _attrs.end(), attr) != _attrs.end();
+  }
+
   libral::error context::error(const std::string& msg) const {
     std::ostringstream os;
 
@@ -141,8 +169,11 @@ namespace libral {
   }
 
   void context::add_absent(std::vector<resource>& rsrcs,
-                           const std::vector<std::string>& names) {
+                           const std::vector<std::string>& names,
+                           const std::set<std::string>& skipped) {
     for (auto& name : names) {
+      if (skipped.count(name) > 0)
+        continue;
       auto rsrc = std::find_if(rsrcs.begin(), rsrcs.end(),
                   [&name](const resource& r) { return name == r.name(); });
       if (rsrc == rsrcs.end()) {
@@ -0,0 +1,324 @@
+#include <libral/coprocess.hpp>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+#include <leatherman/locale/locale.hpp>
+
+using namespace leatherman::locale;
+
+namespace libral {
+
+  static const std::string eom = "ral_eom";
+
+  static void close_fd(int& fd) {
+    if (fd >= 0) {
+      close(fd);
+      fd = -1;
+    }
+  }
+
+  /* Make a pipe whose ends are not inherited by any other child we might
+     run, since a stray copy of the write end of a child's stdin would keep
+     it from ever seeing EOF */
+  static bool make_pipe(int fds[2]) {
+    if (pipe(fds) < 0)
+      return false;
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    return true;
+  }
+
+  /* Return the position of the end-of-message line in buf, or npos if
+     there is none yet */
+  static std::string::size_type find_eom(const std::string& buf) {
+    std::string::size_type pos = 0;
+    while ((pos = buf.find(eom, pos)) != std::string::npos) {
+      auto end = pos + eom.length();
+      if ((pos == 0 || buf[pos-1] == '\n') &&
+          end < buf.length() && buf[end] == '\n') {
+        return pos;
+      }
+      pos = end;
+    }
+    return std::string::npos;
+  }
+
+  result<coprocess::sptr>
+  coprocess::spawn(const std::string& file,
+                   const std::vector<std::string>& args) {
+    int in[2], out[2], err[2], status[2];
+
+    if (! make_pipe(in) || ! make_pipe(out) || ! make_pipe(err)
+        || ! make_pipe(status)) {
+      return error(_("failed to create pipes for {1}: {2}",
+                     file, strerror(errno)));
+    }
+
+    std::vector<char *> argv;
+    argv.push_back(const_cast<char *>(file.c_str()));
+    for (const auto& arg : args) {
+      argv.push_back(const_cast<char *>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    pid_t pid = fork();
+    if (pid < 0) {
+      return error(_("failed to fork for {1}: {2}", file, strerror(errno)));
+    }
+
+    if (pid == 0) {
+      // Child
+      dup2(in[0], 0);
+      dup2(out[1], 1);
+      dup2(err[1], 2);
+      // Put the child into its own process group so that it and anything
+      // it starts can be signalled together
+      setpgid(0, 0);
+      execvp(file.c_str(), argv.data());
+      // Tell the parent why exec failed
+      int e = errno;
+      ssize_t ignored = write(status[1], &e, sizeof(e));
+      (void) ignored;
+      _exit(127);
+    }
+
+    // Parent
+    close(in[0]);
+    close(out[1]);
+    close(err[1]);
+    close(status[1]);
+
+    // The status pipe gets closed without any data on a successful exec
+    int e = 0;
+    ssize_t n;
+    do {
+      n = read(status[0], &e, sizeof(e));
+    } while (n < 0 && errno == EINTR);
+    close(status[0]);
+
+    if (n == sizeof(e)) {
+      int st;
+      waitpid(pid, &st, 0);
+      close(in[1]);
+      close(out[0]);
+      close(err[0]);
+      return error(_("failed to execute {1}: {2}", file, strerror(e)));
+    }
+
+    return sptr(new coprocess(pid, in[1], out[0], err[0]));
+  }
+
+  coprocess::~coprocess() {
+    using clock = std::chrono::steady_clock;
+
+    // Closing stdin tells the child to exit
+    close_fd(_stdin);
+    close_fd(_stderr);
+
+    // The child's stdout reaches EOF once it and everything it started
+    // have exited; wait for that, discarding anything they still print,
+    // for at most a second
+    auto deadline = clock::now() + std::chrono::seconds(1);
+    bool eof = false;
+    char buf[4096];
+    while (! eof) {
+      auto left = std::chrono::duration_cast<std::chrono::milliseconds>
+        (deadline - clock::now()).count();
+      if (left <= 0)
+        break;
+      struct pollfd fd = { _stdout, POLLIN, 0 };
+      int ready = poll(&fd, 1, static_cast<int>(left));
+      if (ready < 0 && errno == EINTR)
+        continue;
+      if (ready <= 0)
+        break;
+      auto n = read(_stdout, buf, sizeof(buf));
+      if (n == 0 || (n < 0 && errno != EINTR))
+        eof = true;
+    }
+    close_fd(_stdout);
+
+    // Look at the child without reaping it, so that its process group
+    // can not have been reused by the time we kill it
+    siginfo_t info;
+    info.si_pid = 0;
+    bool exited =
+      waitid(P_PID, _pid, &info, WEXITED | WNOHANG | WNOWAIT) == 0
+      && info.si_pid == _pid;
+    if (! exited || ! eof) {
+      // Either the child is still running, or something it started still
+      // holds on to its stdout; take all of them down
+      cancellation::kill(_pid);
+    }
+    int status;
+    waitpid(_pid, &status, 0);
+  }
+
+  bool coprocess::in_sync() {
+    char buf[8192];
+    struct pollfd fd = { _stdout, POLLIN, 0 };
+    while (poll(&fd, 1, 0) > 0) {
+      auto n = read(_stdout, buf, sizeof(buf));
+      if (n <= 0)
+        break;
+      _out.append(buf, n);
+    }
+    return _out.empty();
+  }
+
+  result<void> coprocess::write_all(const std::string& s) {
+    // Block SIGPIPE while writing so that a child that has died does not
+    // take us down with it; we get EPIPE from write instead
+    sigset_t pipe_set, old_set;
+    sigemptyset(&pipe_set);
+    sigaddset(&pipe_set, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipe_set, &old_set);
+
+    int write_errno = 0;
+    const char *buf = s.c_str();
+    size_t left = s.length();
+    while (left > 0) {
+      auto n = write(_stdin, buf, left);
+      if (n < 0) {
+        if (errno == EINTR)
+          continue;
+        write_errno = errno;
+        break;
+      }
+      buf += n;
+      left -= n;
+    }
+
+    if (write_errno == EPIPE) {
+      // Consume the SIGPIPE that is now pending for this thread
+      sigset_t pending;
+      sigpending(&pending);
+      if (sigismember(&pending, SIGPIPE)) {
+        int sig;
+        sigwait(&pipe_set, &sig);
+      }
+    }
+    pthread_sigmask(SIG_SETMASK, &old_set, nullptr);
+
+    if (write_errno != 0) {
+      return error(_("failed to write to process {1}: {2}",
+                     _pid, strerror(write_errno)));
+    }
+    return result<void>();
+  }
+
+  /* Pass complete lines from the child's stderr to err_cb; if all is
+     true, also pass whatever incomplete line is left */
+  void coprocess::flush_stderr(std::function<bool(std::string&)>& err_cb,
+                               bool all) {
+    std::string::size_type start = 0, end;
+    while ((end = _err.find('\n', start)) != std::string::npos) {
+      auto line = _err.substr(start, end - start);
+      if (err_cb)
+        err_cb(line);
+      start = end + 1;
+    }
+    _err.erase(0, start);
+    if (all && ! _err.empty()) {
+      if (err_cb)
+        err_cb(_err);
+      _err.clear();
+    }
+  }
+
+  result<std::string>
+  coprocess::request(const std::string& msg,
+                     std::function<bool(std::string&)> err_cb,
+                     const limits& lim) {
+    using clock = std::chrono::steady_clock;
+
+    if (lim.cancel && ! lim.cancel->attach(_pid)) {
+      return error(_("process {1} was cancelled", _pid));
+    }
+    struct detach_guard {
+      const limits& lim;
+      pid_t pid;
+      ~detach_guard() { if (lim.cancel) lim.cancel->detach(pid); }
+    } guard { lim, _pid };
+
+    auto deadline = clock::now() + std::chrono::seconds(lim.timeout);
+
+    std::string req = msg;
+    if (req.empty() || req.back() != '\n')
+      req += '\n';
+    req += eom + "\n";
+
+    err_ret( write_all(req) );
+
+    char buf[8192];
+    while (true) {
+      auto pos = find_eom(_out);
+      if (pos != std::string::npos) {
+        auto answer = _out.substr(0, pos);
+        _out.erase(0, pos + eom.length() + 1);
+        flush_stderr(err_cb, false);
+        return answer;
+      }
+
+      struct pollfd fds[2];
+      nfds_t nfds = 0;
+      fds[nfds++] = { _stdout, POLLIN, 0 };
+      if (_stderr >= 0) {
+        fds[nfds++] = { _stderr, POLLIN, 0 };
+      }
+
+      int wait_ms = -1;
+      if (lim.timeout > 0) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>
+          (deadline - clock::now()).count();
+        wait_ms = left > 0 ? static_cast<int>(left) : 0;
+      }
+
+      int ready = poll(fds, nfds, wait_ms);
+      if (ready < 0) {
+        if (errno == EINTR)
+          continue;
+        return error(_("failed to wait for process {1}: {2}",
+                       _pid, strerror(errno)));
+      }
+      if (ready == 0) {
+        cancellation::kill(_pid);
+        flush_stderr(err_cb, true);
+        return error(_("process {1} was killed since it did not answer within {2} seconds", _pid, lim.timeout));
+      }
+
+      if (nfds > 1 && fds[1].revents != 0) {
+        auto n = read(_stderr, buf, sizeof(buf));
+        if (n > 0) {
+          _err.append(buf, n);
+          flush_stderr(err_cb, false);
+        } else if (n == 0 || errno != EINTR) {
+          flush_stderr(err_cb, true);
+          close_fd(_stderr);
+        }
+      }
+
+      if (fds[0].revents != 0) {
+        auto n = read(_stdout, buf, sizeof(buf));
+        if (n > 0) {
+          _out.append(buf, n);
+        } else if (n == 0 || errno != EINTR) {
+          flush_stderr(err_cb, true);
+          if (lim.cancelled()) {
+            return error(_("process {1} was cancelled", _pid));
+          }
+          return error(_("process {1} exited before finishing its answer",
+                         _pid));
+        }
+      }
+    }
+  }
+}
@@ -1,4 +1,8 @@
+#include <cstring>
+#include <deque>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <string>
 #include <vector>
 #include <stdlib.h>
@@ -31,6 +35,169 @@ static void str_to_cstr(const std::string &s, char **cs) {
     return;
 }
 
+// The state behind the opaque handles; the provider handle keeps the ral
+// alive since providers hold on to their environment
+struct ral_handle {
+    std::shared_ptr<lib::ral> ral;
+    std::vector<std::shared_ptr<lib::provider>> provs;
+};
+
+struct ral_provider {
+    std::shared_ptr<lib::ral> ral;
+    std::shared_ptr<lib::provider> prov;
+};
+
+static uint8_t provider_not_found(const char *prov_name, char **result) {
+    std::string error_msg = _("Provider {1} not found", std::string(prov_name));
+    str_to_cstr(error_msg, result);
+    return EXIT_FAILURE;
+}
+
+static uint8_t resources_of(lib::provider& prov, char **result) {
+    auto resource_instances = prov.get();
+    lib::json_emitter em {};
+    auto resources = em.parse_list(prov, resource_instances);
+    str_to_cstr(resources, result);
+
+    return EXIT_SUCCESS;
+}
+
+static uint8_t resource_of(lib::provider& prov, char **result,
+                           char *resource_name) {
+    auto inst = prov.find(std::string(resource_name));
+    lib::json_emitter em {};
+
+    auto resource = em.parse_find(prov, inst);
+    str_to_cstr(resource, result);
+
+    return EXIT_SUCCESS;
+}
+
+static lib::result<lib::resource> make_should(lib::provider& prov,
+                                              char *resource_name,
+                                              int desired_attributes_c,
+                                              char **desired_attributes) {
+    if (desired_attributes_c < 1) {
+        return lib::error("Number of desired attributes must be > 0");
+    }
+
+    std::vector<std::string> av(desired_attributes, desired_attributes + desired_attributes_c);
+
+    lib::resource should = prov.create(std::string(resource_name));
+
+    for (const auto& arg : av) {
+        auto found = arg.find("=");
+        if (found != std::string::npos) {
+            auto attr = arg.substr(0, found);
+            auto value = prov.parse(attr, arg.substr(found+1));
+            if (value) {
+                should[attr] = value.ok();
+            } else {
+                return lib::error(_("Failed to read attribute {1}, resource_name: {2}, error: {3}", attr, std::string(resource_name), value.err().detail));
+            }
+        }
+    }
+    return should;
+}
+
+static uint8_t set_resource_of(lib::provider& prov, char **result,
+                               char *resource_name,
+                               int desired_attributes_c,
+                               char **desired_attributes) {
+    auto should = make_should(prov, resource_name,
+                              desired_attributes_c, desired_attributes);
+    if (!should) {
+        str_to_cstr(should.err().detail, result);
+        return EXIT_FAILURE;
+    }
+
+    lib::json_emitter em {};
+
+    auto res = prov.set({ should.ok() });
+    auto setres = em.parse_set(prov, res);
+
+    str_to_cstr(setres, result);
+    return EXIT_SUCCESS;
+}
+
+// The records handed out by ral_provider_get_records and the strings they
+// point to; everything is released in one go by ral_free_records
+struct records_buf : ral_records {
+    // A deque never moves its elements, so the pointers stay valid
+    std::deque<std::string> strings;
+    std::map<std::string, const char *> attr_names;
+    std::vector<ral_record> recs;
+
+    records_buf(const lib::provider& prov) {
+        type_name = intern(prov.type_name());
+        provider = intern(prov.qname());
+        count = 0;
+        records = nullptr;
+        error = nullptr;
+    }
+
+    const char *intern(const std::string& s) {
+        strings.push_back(s);
+        return strings.back().c_str();
+    }
+
+    // Attribute names are the same for most resources; only keep one
+    // copy of each
+    const char *attr_name(const std::string& attr) {
+        auto it = attr_names.find(attr);
+        if (it == attr_names.end()) {
+            it = attr_names.emplace(attr, intern(attr)).first;
+        }
+        return it->second;
+    }
+
+    void add(uint8_t kind, const char *name, const char *attr = nullptr,
+             const char *value = nullptr, const char *was = nullptr) {
+        recs.push_back(ral_record { kind, name, attr, value, was });
+    }
+
+    const char *add_resource(const lib::resource& rsrc) {
+        auto name = intern(rsrc.name());
+        add(RAL_RECORD_RESOURCE, name);
+        for (const auto& a : rsrc.attrs()) {
+            auto attr = attr_name(a.first);
+            const auto& v = a.second;
+            if (auto str = v.as<std::string>()) {
+                add(RAL_RECORD_STRING, name, attr, intern(*str));
+            } else if (auto b = v.as<bool>()) {
+                add(RAL_RECORD_BOOL, name, attr, *b ? "true" : "false");
+            } else if (auto ary = v.as<lib::array>()) {
+                add(RAL_RECORD_ARRAY, name, attr);
+                for (const auto& item : *ary) {
+                    add(RAL_RECORD_ITEM, name, attr, intern(item));
+                }
+            }
+            // Attributes without a value are left out
+        }
+        return name;
+    }
+
+    void add_changes(const char *name, const lib::changes& chgs) {
+        for (const auto& ch : chgs) {
+            add(RAL_RECORD_CHANGE, name, attr_name(ch.attr),
+                ch.is ? intern(ch.is.to_string()) : nullptr,
+                ch.was ? intern(ch.was.to_string()) : nullptr);
+        }
+    }
+
+    uint8_t finish() {
+        count = recs.size();
+        records = recs.data();
+        return EXIT_SUCCESS;
+    }
+
+    uint8_t fail(const std::string& msg) {
+        error = intern(msg);
+        finish();
+        return EXIT_FAILURE;
+    }
+};
+
 //
 // Public interface
 //
@@ -52,17 +219,10 @@ uint8_t get_resources(char **result, char *prov_name) {
     auto opt_prov = ral->find_provider(std::string(prov_name));
 
     if (!opt_prov) {
-        std::string error_msg = _("Provider {1} not found", std::string(prov_name));
-        str_to_cstr(error_msg, result);
-        return EXIT_FAILURE;
+        return provider_not_found(prov_name, result);
     }
 
-    auto resource_instances = (*opt_prov)->get();
-    lib::json_emitter em {};
-    auto resources = em.parse_list(**opt_prov, resource_instances);
-    str_to_cstr(resources, result);
-
-    return EXIT_SUCCESS;
+    return resources_of(**opt_prov, result);
 }
 
 uint8_t get_resource(char **result, char *prov_name, char *resource_name) {
@@ -71,18 +231,10 @@ uint8_t get_resource(char **result, char *prov_name, char *resource_name) {
     auto opt_prov = ral->find_provider(std::string(prov_name));
 
     if (!opt_prov) {
-        std::string error_msg = _("Provider {1} not found", std::string(prov_name));
-        str_to_cstr(error_msg, result);
-        return EXIT_FAILURE;
+        return provider_not_found(prov_name, result);
     }
 
-    auto inst = (*opt_prov)->find(std::string(resource_name));
-    lib::json_emitter em {};
-
-    auto resource = em.parse_find(**opt_prov, inst);
-    str_to_cstr(resource, result);
-
-    return EXIT_SUCCESS;
+    return resource_of(**opt_prov, result, resource_name);
 }
 
 uint8_t set_resource(char **result, char *prov_name, char *resource_name, int desired_attributes_c, char **desired_attributes) {
@@ -91,41 +243,114 @@ uint8_t set_resource(char **result, char *prov_name, char *resource_name, int de
     auto opt_prov = ral->find_provider(std::string(prov_name));
 
     if (!opt_prov) {
-        std::string error_msg = _("Provider {1} not found", std::string(prov_name));
-        str_to_cstr(error_msg, result);
-        return EXIT_FAILURE;
+        return provider_not_found(prov_name, result);
     }
 
-    if (desired_attributes_c < 1) {
-        str_to_cstr("Number of desired attributes must be > 0", result);
-        return EXIT_FAILURE;
+    return set_resource_of(**opt_prov, result, resource_name,
+                           desired_attributes_c, desired_attributes);
+}
+
+void free_result(char *result) {
+    // str_to_cstr allocates with new[]
+    delete[] result;
+}
+
+ral_handle *ral_open(int data_dirs_c, char **data_dirs) {
+    std::vector<std::string> dirs;
+    if (data_dirs_c > 0) {
+        dirs.assign(data_dirs, data_dirs + data_dirs_c);
     }
 
-    std::vector<std::string> av(desired_attributes, desired_attributes + desired_attributes_c);
+    auto handle = new ral_handle;
+    handle->ral = lib::ral::create(dirs);
+    handle->provs = handle->ral->providers();
+    return handle;
+}
 
-    auto& prov = *opt_prov;
-    lib::resource should = prov->create(std::string(resource_name));
+void ral_close(ral_handle *ral) {
+    delete ral;
+}
 
-    for (const auto& arg : av) {
-        auto found = arg.find("=");
-        if (found != std::string::npos) {
-            auto attr = arg.substr(0, found);
-            auto value = prov->parse(attr, arg.substr(found+1));
-            if (value) {
-                should[attr] = value.ok();
-            } else {
-                std::string error_msg = _("Failed to read attribute {1}, resource_name: {2}, error: {3}", attr, std::string(prov_name), value.err().detail);
-                str_to_cstr(error_msg, result);
-                return EXIT_FAILURE;
-            }
+uint8_t ral_get_providers(ral_handle *ral, char **result) {
+    lib::json_emitter em {};
+    auto provs = em.parse_providers(ral->provs);
+    str_to_cstr(provs, result);
+
+    return EXIT_SUCCESS;
+}
+
+ral_provider *ral_find_provider(ral_handle *ral, char *type_name) {
+    auto opt_prov = lib::ral::find_provider(std::string(type_name), ral->provs);
+    if (!opt_prov) {
+        return nullptr;
+    }
+    return new ral_provider { ral->ral, *opt_prov };
+}
+
+void ral_provider_close(ral_provider *prov) {
+    delete prov;
+}
+
+uint8_t ral_provider_get_resources(ral_provider *prov, char **result) {
+    return resources_of(*prov->prov, result);
+}
+
+uint8_t ral_provider_get_resource(ral_provider *prov, char **result, char *resource_name) {
+    return resource_of(*prov->prov, result, resource_name);
+}
+
+uint8_t ral_provider_set_resource(ral_provider *prov, char **result, char *resource_name, int desired_attributes_c, char **desired_attributes) {
+    return set_resource_of(*prov->prov, result, resource_name,
+                           desired_attributes_c, desired_attributes);
+}
+
+uint8_t ral_provider_get_records(ral_provider *prov, ral_records **result, char *resource_name) {
+    auto& p = *prov->prov;
+    auto buf = new records_buf(p);
+    *result = buf;
+
+    if (resource_name == nullptr) {
+        auto rsrcs = p.get();
+        if (!rsrcs) {
+            return buf->fail(rsrcs.err().detail);
+        }
+        for (const auto& rsrc : rsrcs.ok()) {
+            buf->add_resource(rsrc);
+        }
+    } else {
+        auto inst = p.find(std::string(resource_name));
+        if (!inst) {
+            return buf->fail(inst.err().detail);
+        }
+        if (inst.ok()) {
+            buf->add_resource(*inst.ok());
         }
     }
+    return buf->finish();
+}
 
-    lib::json_emitter em {};
+uint8_t ral_provider_set_records(ral_provider *prov, ral_records **result, char *resource_name, int desired_attributes_c, char **desired_attributes) {
+    auto& p = *prov->prov;
+    auto buf = new records_buf(p);
+    *result = buf;
 
-    auto res = prov->set({ should });
-    auto setres = em.parse_set(**opt_prov, res);
+    auto should = make_should(p, resource_name,
+                              desired_attributes_c, desired_attributes);
+    if (!should) {
+        return buf->fail(should.err().detail);
+    }
 
-    str_to_cstr(setres, result);
-    return EXIT_SUCCESS;
+    auto res = p.set({ should.ok() });
+    if (!res) {
+        return buf->fail(res.err().detail);
+    }
+    for (const auto& pair : res.ok()) {
+        auto name = buf->add_resource(p.create(pair.first, pair.second));
+        buf->add_changes(name, pair.second);
+    }
+    return buf->finish();
+}
+
+void ral_free_records(ral_records *records) {
+    delete static_cast<records_buf *>(records);
 }
@@ -24,26 +24,49 @@ namespace libral {
       js.set<json>("error", err);
     } else {
       std::vector<json> js_rslt;
-      for(const auto& pair : rslt.ok()) {
-        json js_pair;
-        const auto rsrc = prov.create(pair.first, pair.second);
-        js_pair.set<json>("resource", resource_to_json(prov, rsrc));
-        std::vector<json> json_changes;
-        for (const auto& ch : pair.second) {
-          json json_ch;
-          json_ch.set<std::string>("attr", ch.attr);
-          json_set_value(json_ch, "is", ch.is);
-          json_set_value(json_ch, "was", ch.was);
-          json_changes.push_back(json_ch);
-        }
-        js_pair.set<std::vector<json>>("changes", json_changes);
-        js_rslt.push_back(js_pair);
-      }
+      set_to_json(prov, rslt, js_rslt);
       js.set<std::vector<json>>("result", js_rslt);
     }
     return js.toString();
   }
 
+  std::string json_emitter::parse_sets(const sets& sts) {
+    json js;
+
+    std::vector<json> js_rslt;
+    std::vector<json> errors;
+    for (const auto& s : sts) {
+      if (!s.second) {
+        errors.push_back(error_to_json(*s.first, s.second.err()));
+      } else {
+        set_to_json(*s.first, s.second, js_rslt);
+      }
+    }
+    js.set<std::vector<json>>("result", js_rslt);
+    js.set<std::vector<json>>("errors", errors);
+    return js.toString();
+  }
+
+  void json_emitter::set_to_json(const provider &prov,
+                                 const set_result& rslt,
+                                 std::vector<json>& js_rslt) {
+    for(const auto& pair : rslt.ok()) {
+      json js_pair;
+      const auto rsrc = prov.create(pair.first, pair.second);
+      js_pair.set<json>("resource", resource_to_json(prov, rsrc));
+      std::vector<json> json_changes;
+      for (const auto& ch : pair.second) {
+        json json_ch;
+        json_ch.set<std::string>("attr", ch.attr);
+        json_set_value(json_ch, "is", ch.is);
+        json_set_value(json_ch, "was", ch.was);
+        json_changes.push_back(json_ch);
+      }
+      js_pair.set<std::vector<json>>("changes", json_changes);
+      js_rslt.push_back(js_pair);
+    }
+  }
+
   std::string json_emitter::parse_find(const provider &prov,
                        const result<boost::optional<resource>> &inst) {
     json js;
@@ -76,6 +99,61 @@ namespace libral {
     return js.toString();
   }
 
+  std::string json_emitter::parse_lists(const lists& lsts) {
+    json js;
+
+    std::vector<json> list;
+    std::vector<json> errors;
+    for (const auto& l : lsts) {
+      const auto& prov = *l.first;
+      const auto& rslt = l.second;
+      if (!rslt) {
+        errors.push_back(error_to_json(prov, rslt.err()));
+      } else {
+        for (const auto& inst : rslt.ok()) {
+          list.push_back(resource_to_json(prov, inst));
+        }
+      }
+    }
+    js.set<std::vector<json>>("resources", list);
+    js.set<std::vector<json>>("errors", errors);
+    return js.toString();
+  }
+
+  std::string
+  json_emitter::parse_diff(const std::vector<snapshot::difference>& diffs) {
+    using state = snapshot::difference::state;
+    json js;
+
+    std::vector<json> list;
+    for (const auto& d : diffs) {
+      json entry;
+      entry.set<std::string>("type", d.type);
+      entry.set<std::string>("provider", d.provider);
+      entry.set<std::string>("name", d.name);
+      switch(d.what) {
+      case state::added:   entry.set<std::string>("state", "added"); break;
+      case state::removed: entry.set<std::string>("state", "removed"); break;
+      case state::changed: entry.set<std::string>("state", "changed"); break;
+      }
+
+      std::vector<json> json_changes;
+      for (const auto& ch : d.chgs) {
+        json json_ch;
+        json_ch.set<std::string>("attr", ch.attr);
+        if (d.what != state::removed)
+          json_set_value(json_ch, "is", ch.is);
+        if (d.what != state::added)
+          json_set_value(json_ch, "was", ch.was);
+        json_changes.push_back(json_ch);
+      }
+      entry.set<std::vector<json>>("changes", json_changes);
+      list.push_back(entry);
+    }
+    js.set<std::vector<json>>("differences", list);
+    return js.toString();
+  }
+
   std::string json_emitter::parse_providers(const std::vector<std::shared_ptr<provider>>& provs) {
     json js;
     std::vector<json> list;
@@ -120,6 +198,11 @@ namespace libral {
     std::cout << js_s << std::endl;
   }
 
+  void json_emitter::print_sets(const sets& sts) {
+    auto js_s = parse_sets(sts);
+    std::cout << js_s << std::endl;
+  }
+
   void json_emitter::print_find(const provider &prov,
                const result<boost::optional<resource>> &resource) {
     auto js_s = parse_find(prov, resource);
@@ -132,6 +215,17 @@ namespace libral {
     std::cout << js_s << std::endl;
   }
 
+  void json_emitter::print_lists(const lists& lsts) {
+    auto js_s = parse_lists(lsts);
+    std::cout << js_s << std::endl;
+  }
+
+  void
+  json_emitter::print_diff(const std::vector<snapshot::difference>& diffs) {
+    auto js_s = parse_diff(diffs);
+    std::cout << js_s << std::endl;
+  }
+
   void json_emitter::print_providers(const std::vector<std::shared_ptr<provider>>& provs) {
     auto js_s = parse_providers(provs);
     std::cout << js_s << std::endl;
@@ -148,6 +242,12 @@ namespace libral {
     return js;
   }
 
+  json json_emitter::error_to_json(const provider &prov, const error& err) {
+    json js = json_meta(prov);
+    js.set<std::string>("message", _("failed: {1}", err.detail));
+    return js;
+  }
+
   json json_emitter::json_meta(const provider &prov) {
       json meta;
       meta.set<std::string>("type", prov.type_name());
@@ -72,6 +72,63 @@ namespace libral {
     }
   }
 
+  void puppet_emitter::print_sets(const sets& sts) {
+    for (const auto& s : sts) {
+      if (!s.second) {
+        std::cout << color::red
+                  << _("{1} failed: {2}", s.first->qname(),
+                       s.second.err().detail)
+                  << color::reset << std::endl;
+        continue;
+      }
+      print_set(*s.first, s.second);
+    }
+  }
+
+  void puppet_emitter::print_lists(const lists& lsts) {
+    for (const auto& l : lsts) {
+      if (!l.second) {
+        std::cout << color::red
+                  << _("{1} failed: {2}", l.first->qname(),
+                       l.second.err().detail)
+                  << color::reset << std::endl;
+        continue;
+      }
+      print_list(*l.first, l.second);
+    }
+  }
+
+  void
+  puppet_emitter::print_diff(const std::vector<snapshot::difference>& diffs) {
+    using state = snapshot::difference::state;
+    for (const auto& d : diffs) {
+      switch(d.what) {
+      case state::added:   std::cout << color::green << "+ "; break;
+      case state::removed: std::cout << color::red << "- "; break;
+      case state::changed: std::cout << color::yellow << "~ "; break;
+      }
+      std::cout << d.provider << "['" << d.name << "']"
+                << color::reset << std::endl;
+
+      uint16_t maxlen = 0;
+      for (const auto& ch : d.chgs) {
+        if (ch.attr.length() > maxlen) maxlen = ch.attr.length();
+      }
+      for (const auto& ch : d.chgs) {
+        std::cout << "  " << color::green << std::left << std::setw(maxlen)
+                  << ch.attr << color::reset << " : ";
+        if (d.what == state::added) {
+          std::cout << ch.is;
+        } else if (d.what == state::removed) {
+          std::cout << ch.was;
+        } else {
+          std::cout << ch.was << " => " << ch.is;
+        }
+        std::cout << std::endl;
+      }
+    }
+  }
+
   void
   puppet_emitter::print_providers(const std::vector<std::shared_ptr<provider>>& provs) {
     for (const auto& p : provs) {
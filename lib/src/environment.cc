@@ -33,6 +33,10 @@ namespace libral {
     return _ral->target()->augeas(xfms);
   }
 
+  result<std::string> environment::read(const std::string& path) const {
+    return _ral->target()->read(path);
+  }
+
   result<prov::spec>
   environment::parse_spec(const std::string& name,
                           const std::string& desc,
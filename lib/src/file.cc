@@ -95,15 +95,29 @@ namespace libral {
         // Boost 1.58 which pl-build-tools has on CentOS 6
         auto cname = fs::absolute(fs::path(name));
         auto rsrc = create(cname.native());
-        load(rsrc);
+        if (! ctx.admits(rsrc))
+          continue;
+        load(ctx, rsrc);
         res.push_back(rsrc);
       }
       return res;
     }
   }
 
-  // Load file attributes into res from whatever is on disk
-  void file_provider::load(resource &res) {
+  std::vector<std::string>
+  file_provider::watch_paths(const std::vector<std::string>& names) const {
+    // We can not list all files, and therefore not watch all of them
+    // either
+    std::vector<std::string> paths;
+    for (const auto& name : names) {
+      paths.push_back(fs::absolute(fs::path(name)).native());
+    }
+    return paths;
+  }
+
+  // Load the file attributes that ctx wants into res from whatever is on
+  // disk
+  void file_provider::load(const context &ctx, resource &res) {
     /* Look up file and fill in attributes */
     boost::system::error_code ec;
     auto st = fs::symlink_status(res.name(), ec);
@@ -130,7 +144,8 @@ namespace libral {
       res["mode"] = os.str();
     }
 
-    {
+    if (ctx.wants("mtime") || ctx.wants("checksum")
+        || ctx.wants("checksum_value")) {
       // Get mtime; we lose the subsecond bits of mtime
       auto mtime = fs::last_write_time(res.name());
       res["mtime"] = time_as_iso_string(&mtime);
@@ -142,7 +157,9 @@ namespace libral {
       res["checksum"] = "mtime";
     }
 
-    find_from_stat(res);
+    if (ctx.wants("ctime") || ctx.wants("owner") || ctx.wants("group")) {
+      find_from_stat(res);
+    }
   }
 
   /* Fill in attributes we can only get via stat(2) and not from
@@ -0,0 +1,189 @@
+#include <libral/filter.hpp>
+
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+
+#include <fnmatch.h>
+
+#include <leatherman/locale/locale.hpp>
+
+using namespace leatherman::locale;
+
+namespace libral {
+
+  namespace {
+    struct op_entry {
+      std::string name;
+      filter::op  oper;
+    };
+
+    // Longer operators come first, so that '<=' is not read as '<'
+    const std::vector<op_entry>& ops() {
+      static const std::vector<op_entry> entries = {
+        { "!=", filter::op::ne },
+        { "<=", filter::op::le },
+        { ">=", filter::op::ge },
+        { "=",  filter::op::eq },
+        { "<",  filter::op::lt },
+        { ">",  filter::op::gt },
+        { "~",  filter::op::glob } };
+      return entries;
+    }
+
+    bool as_integer(const std::string& s, long long& n) {
+      if (s.empty())
+        return false;
+      char *end;
+      errno = 0;
+      n = strtoll(s.c_str(), &end, 10);
+      return errno == 0 && *end == '\0';
+    }
+
+    /* Returns a negative number, zero, or a positive number if s is less,
+       equal, or greater than operand */
+    int compare(const std::string& s, const std::string& operand) {
+      long long a, b;
+      if (as_integer(s, a) && as_integer(operand, b)) {
+        return (a < b) ? -1 : (a > b);
+      }
+      return s.compare(operand);
+    }
+
+    bool matches_one(const filter::predicate& pred, const std::string& s) {
+      switch(pred.oper) {
+      case filter::op::eq:
+        return s == pred.operand;
+      case filter::op::ne:
+        return s != pred.operand;
+      case filter::op::lt:
+        return compare(s, pred.operand) < 0;
+      case filter::op::le:
+        return compare(s, pred.operand) <= 0;
+      case filter::op::gt:
+        return compare(s, pred.operand) > 0;
+      case filter::op::ge:
+        return compare(s, pred.operand) >= 0;
+      case filter::op::glob:
+        return fnmatch(pred.operand.c_str(), s.c_str(), 0) == 0;
+      }
+      return false;
+    }
+  }
+
+  bool filter::predicate::matches(const value& v) const {
+    if (auto s = v.as<std::string>()) {
+      return matches_one(*this, *s);
+    } else if (auto b = v.as<bool>()) {
+      return matches_one(*this, *b ? "true" : "false");
+    } else if (auto ary = v.as<array>()) {
+      if (oper == op::ne) {
+        for (const auto& s : *ary) {
+          if (s == operand)
+            return false;
+        }
+        return true;
+      }
+      for (const auto& s : *ary) {
+        if (matches_one(*this, s))
+          return true;
+      }
+      return false;
+    }
+    // The attribute is not set
+    return oper == op::ne;
+  }
+
+  const std::string& filter::predicate::op_name() const {
+    for (const auto& e : ops()) {
+      if (e.oper == oper)
+        return e.name;
+    }
+    // Not reached, every operator is in ops()
+    return ops().front().name;
+  }
+
+  std::string filter::predicate::to_string() const {
+    return attr + op_name() + operand;
+  }
+
+  result<filter::predicate>
+  filter::parse_predicate(const std::string& expr) {
+    // Attribute names consist of letters, digits and underscores
+    size_t i = 0;
+    while (i < expr.size() && (isalnum(expr[i]) || expr[i] == '_'))
+      i++;
+    if (i == 0) {
+      return error(_("filter '{1}' must start with the name of an attribute",
+                     expr));
+    }
+
+    // Providers get the conditions of a filter one per line
+    if (expr.find('\n') != std::string::npos) {
+      return error(_("filter '{1}' must not contain a newline", expr));
+    }
+
+    for (const auto& e : ops()) {
+      if (expr.compare(i, e.name.size(), e.name) == 0) {
+        return predicate { expr.substr(0, i), e.oper,
+                           expr.substr(i + e.name.size()) };
+      }
+    }
+    return error(_("filter '{1}' must compare the attribute {2} with one of =, !=, <, <=, >, >= or ~",
+                   expr, expr.substr(0, i)));
+  }
+
+  result<filter> filter::parse(const std::vector<std::string>& exprs) {
+    filter filt;
+    for (const auto& expr : exprs) {
+      auto pred = parse_predicate(expr);
+      err_ret( pred );
+      filt._preds.push_back(std::move(pred.ok()));
+    }
+    return std::move(filt);
+  }
+
+  bool filter::mentions(const std::string& attr) const {
+    for (const auto& pred : _preds) {
+      if (pred.attr == attr)
+        return true;
+    }
+    return false;
+  }
+
+  bool filter::matches(const resource& res, bool partial) const {
+    for (const auto& pred : _preds) {
+      if (pred.attr == "name") {
+        if (! matches_one(pred, res.name()))
+          return false;
+        continue;
+      }
+      auto it = res.attrs().find(pred.attr);
+      if (it == res.attrs().end()) {
+        if (partial)
+          continue;
+        if (! pred.matches(value::none))
+          return false;
+      } else if (! pred.matches(it->second)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool filter::matches(const resource& res) const {
+    return matches(res, false);
+  }
+
+  bool filter::admits(const resource& res) const {
+    return matches(res, true);
+  }
+
+  std::vector<std::string> filter::to_strings() const {
+    std::vector<std::string> result;
+    for (const auto& pred : _preds) {
+      result.push_back(pred.to_string());
+    }
+    return result;
+  }
+}
@@ -31,6 +31,7 @@ namespace libral {
                       const std::vector<std::string>& names,
                       const resource::attributes& config) {
     std::vector<resource> res;
+    std::set<std::string> skipped;
     struct group *g = NULL;
 
     setgrent();
@@ -39,6 +40,10 @@ namespace libral {
       auto group = create(g->gr_name);
       group["ensure"]  = "present";
       group["gid"]     = std::to_string(g->gr_gid);
+      if (! ctx.admits(group)) {
+        skipped.insert(group.name());
+        continue;
+      }
       if (*g->gr_mem != nullptr) {
         array members;
         for (auto mem = g->gr_mem; *mem != nullptr; mem++) {
@@ -50,10 +55,15 @@ namespace libral {
     }
     endgrent();
 
-    ctx.add_absent(res, names);
+    ctx.add_absent(res, names, skipped);
     return std::move(res);
   }
 
+  std::vector<std::string>
+  group_provider::watch_paths(const std::vector<std::string>& names) const {
+    return { "/etc/group" };
+  }
+
   result<void>
   group_provider::set(context &ctx, const updates& upds) {
     for (auto& upd : upds) {
@@ -94,16 +104,17 @@ namespace libral {
       if (! chgs.empty()) {
         result<void> run_result;
         if (state == "present") {
-          run_result = _cmd_groupmod->run(args);
+          run_result = _cmd_groupmod->run(args, ctx.limits_for("set"));
         } else {
-          run_result = _cmd_groupadd->run(args);
+          run_result = _cmd_groupadd->run(args, ctx.limits_for("set"));
         }
         if (! run_result)
           return run_result;
       }
     } else if (ensure == "absent") {
       if (state != "absent") {
-        auto run_result = _cmd_groupdel->run({ upd.name() });
+        auto run_result = _cmd_groupdel->run({ upd.name() },
+                                             ctx.limits_for("set"));
         if (! run_result)
           return run_result.err();
       }
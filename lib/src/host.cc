@@ -8,28 +8,76 @@ namespace libral {
 #include "host.yaml"
       ;
 
-    auto aug = env.augeas({ { "Hosts.lns", "/etc/hosts" } });
-    err_ret(aug);
-
-    _aug = aug.ok();
+    // Parsing /etc/hosts is expensive; wait with it until we are actually
+    // asked to do something
+    _env = env;
 
     return env.parse_spec("host", desc);
   }
 
+  result<void> host_provider::load() {
+    if (! _aug) {
+      auto aug = _env->augeas({ { "Hosts.lns", "/etc/hosts" } });
+      err_ret(aug);
+
+      _aug = aug.ok();
+    } else {
+      // Only rereads /etc/hosts if it changed
+      err_ret( _aug->load() );
+    }
+    return result<void>();
+  }
+
+  result<boost::optional<provider::token>> host_provider::state_token() {
+    err_ret( load() );
+    return boost::optional<token>(_aug->generation());
+  }
+
+  std::vector<std::string>
+  host_provider::watch_paths(const std::vector<std::string>& names) const {
+    return { "/etc/hosts" };
+  }
+
+  result<std::vector<aug::node>> host_provider::entries() {
+    auto nodes = _aug->match("/files/etc/hosts/*[label() != '#comment']");
+    err_ret( nodes );
+
+    _paths.clear();
+    for (const auto& node : nodes.ok()) {
+      auto name = node["canonical"];
+      err_ret(name);
+
+      if (name.ok()) {
+        _paths[**name].push_back(node.path());
+      } else {
+        // Can't happen, the lens makes sure we always have a 'canonical' entry
+        return error(_("Missing canonical host name"));
+      }
+    }
+    _index_gen = _aug->generation();
+    return nodes;
+  }
+
   result<aug::node>
   host_provider::base(const update &upd) {
-    // There could be multiple matches in a malformed /etc/hosts file. The
+    // The handle is shared with other providers, which might have
+    // reloaded or saved it since we built the index
+    if (! _index_gen || *_index_gen != _aug->generation()) {
+      err_ret( entries() );
+    }
+
+    // There could be multiple entries in a malformed /etc/hosts file. The
     // libral framework makes sure we do not modify these entries before we
     // ever get here - if there are duplicate entries, set() will never be
     // called, which is the only thing using this method
-    auto nodes =
-      _aug->match("/files/etc/hosts/*[canonical = '" + upd.name() + "']");
-    err_ret( nodes );
-
-    if (nodes.ok().size() == 1) {
-      return (nodes.ok())[0];
-    } else if (nodes.ok().size() == 0) {
-      return _aug->make_node_seq_next("/files/etc/hosts");
+    auto& paths = _paths[upd.name()];
+
+    if (paths.size() == 1) {
+      return _aug->make_node(paths.front());
+    } else if (paths.size() == 0) {
+      auto node = _aug->make_node_seq_next("/files/etc/hosts");
+      paths.push_back(node.path());
+      return node;
     } else {
       // We still generate an error if we get more than one match just to be
       // defensive
@@ -62,27 +110,37 @@ namespace libral {
   host_provider::get(context &ctx,
                      const std::vector<std::string>& names,
                      const resource::attributes& config) {
-    std::vector<resource> res;
+    err_ret( load() );
 
-    auto nodes = _aug->match("/files/etc/hosts/*[label() != '#comment']");
-    err_ret( nodes );
+    // Unless nothing has changed since the last time we looked, read
+    // everything into the cache
+    if (! _cache_gen || *_cache_gen != _aug->generation()) {
+      auto nodes = entries();
+      err_ret( nodes );
 
-    for(const auto& node : nodes.ok()) {
-      auto name = node["canonical"];
-      err_ret(name);
+      _cache.clear();
+      for(const auto& node : nodes.ok()) {
+        auto name = node["canonical"];
+        err_ret(name);
 
-      if (name.ok()) {
         auto r = make(**name, node, "present");
         err_ret(r);
 
-        res.push_back(std::move(r.ok()));
-      } else {
-        // Can't happen, the lens makes sure we always have a 'canonical' entry
-        return error(_("Missing canonical host name"));
+        _cache.push_back(std::move(r.ok()));
       }
+      _cache_gen = _aug->generation();
     }
 
-    ctx.add_absent(res, names);
+    std::vector<resource> res;
+    std::set<std::string> skipped;
+    for (const auto& r : _cache) {
+      if (ctx.admits(r))
+        res.push_back(r);
+      else
+        skipped.insert(r.name());
+    }
+
+    ctx.add_absent(res, names, skipped);
     return std::move(res);
   }
 
@@ -109,6 +167,8 @@ namespace libral {
   result<void>
   host_provider::set(context &ctx,
                       const updates& upds) {
+    err_ret( load() );
+
     for (auto upd : upds) {
       err_ret( set(ctx, upd) );
     }
@@ -128,7 +188,11 @@ namespace libral {
       changes.add({ "ip", "host_aliases", "comment" }, upd);
       return update_base(upd);
     } else if (ensure == "absent") {
-      return base(upd).ok().rm();
+      auto bs = base(upd);
+      err_ret( bs );
+      err_ret( bs.ok().rm() );
+      _paths.erase(upd.name());
+      return result<void>();
     } else {
       return error(_("ensure has illegal value '{1}'", ensure));
     }
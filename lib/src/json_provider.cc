@@ -133,6 +133,20 @@ namespace libral {
     std::vector<resource> result;
     auto inp = json_container();
     inp.set<std::vector<std::string>>("names", names);
+    if (! ctx.attrs().empty()) {
+      inp.set<std::vector<std::string>>("attrs", ctx.wanted_attrs());
+    }
+    if (spec()->filter() && ! ctx.filter().empty()) {
+      std::vector<json_container> preds;
+      for (const auto& pred : ctx.filter().predicates()) {
+        json_container js;
+        js.set<std::string>("attr", pred.attr);
+        js.set<std::string>("op", pred.op_name());
+        js.set<std::string>("value", pred.operand);
+        preds.push_back(js);
+      }
+      inp.set<std::vector<json_container>>("filter", preds);
+    }
 
     auto out = run_action(ctx, "get", inp);
     err_ret(out);
@@ -164,36 +178,85 @@ namespace libral {
                             const json_container& json) {
     auto inp = json.toString();
     ctx.log_debug("passing {1} on stdin", inp);
-    auto res = _cmd->execute({ "ral_action=" + action }, inp);
-    if (!res.error.empty()) {
-      // FIXME: this should really happen in a callback while the command
-      // is running rather than after the command finished. For that, we'd
-      // have to switch to exe::each_line and accumulate res.output
-      std::istringstream is(res.error);
-      std::string line;
-      while (std::getline(is, line, '\n')) {
-        ctx.log_line(line);
-      }
-    }
-    if (!res.success) {
-      if (res.output.empty()) {
-        return ctx.error(_("action '{1}' exited with status {2}",
-                           action, res.exit_code));
-      } else {
-        if (res.error.empty()) {
-          return ctx.error(
+
+    // Log stderr while the command is running, and collect stdout
+    // directly into the buffer we hand to the JSON parser
+    std::string out;
+    bool have_stderr = false;
+    auto out_cb = [&out](std::string& line) {
+      out.append(line);
+      out.push_back('\n');
+      return true;
+    };
+    auto err_cb = [&ctx, &have_stderr](std::string& line) {
+      have_stderr = true;
+      ctx.log_line(line);
+      return true;
+    };
+
+    if (_persistent) {
+      auto ans = run_persistent(ctx, action, inp, err_cb);
+      err_ret(ans);
+      out = std::move(ans.ok());
+    } else {
+      auto res = _cmd->execute({ "ral_action=" + action }, inp,
+                               out_cb, err_cb, ctx.limits_for(action));
+      if (!res.success) {
+        if (! res.error.empty()) {
+          // We were killed because of the limits
+          return ctx.error(_("action '{1}' failed: {2}", action, res.error));
+        }
+        if (out.empty()) {
+          return ctx.error(_("action '{1}' exited with status {2}",
+                             action, res.exit_code));
+        } else {
+          if (!have_stderr) {
+            return ctx.error(
                       _("action '{1}' exited with status {2}. Output was '{3}'",
-                        action, res.exit_code, res.output));
+                        action, res.exit_code, out));
+          }
         }
       }
     }
 
     try {
-      return json_container(res.output);
+      return json_container(out);
     } catch (json::data_parse_error& e) {
       return ctx.error(_("action '{1}' returned invalid JSON '{2}'",
-                         action, res.output));
+                         action, out));
+    }
+  }
+
+  result<std::string>
+  json_provider::run_persistent(context& ctx,
+                                const std::string& action,
+                                const std::string& inp,
+                                std::function<bool(std::string&)> err_cb) {
+    if (_proc && ! _proc->in_sync()) {
+      // The provider said more than it was asked for, and all answers from
+      // it would be off by one from now on
+      ctx.log_debug("provider printed output outside of an answer, restarting it");
+      _proc.reset();
+    }
+    if (! _proc) {
+      auto proc = _cmd->spawn({ "ral_action=serve" });
+      if (!proc) {
+        return ctx.error(_("failed to start provider: {1}",
+                           proc.err().detail));
+      }
+      _proc = proc.ok();
+    }
+
+    auto ans = _proc->request("ral_action=" + action + "\n" + inp, err_cb,
+                              ctx.limits_for(action));
+    if (!ans) {
+      // We can't tell where the conversation stands; start over with a
+      // fresh process on the next action
+      _proc.reset();
+      return ctx.error(_("action '{1}' failed: {2}",
+                         action, ans.err().detail));
     }
+    return ans;
   }
 
   bool json_provider::contains_error(const json_container& json,
@@ -0,0 +1,166 @@
+#include <libral/manifest.hpp>
+
+#include <libral/ral.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <set>
+
+#include <leatherman/json_container/json_container.hpp>
+#include <leatherman/locale/locale.hpp>
+
+using namespace leatherman::locale;
+namespace json = leatherman::json_container;
+using json_container = json::JsonContainer;
+
+namespace libral {
+
+  result<manifest>
+  manifest::parse(const std::string& text,
+                  const std::vector<std::shared_ptr<provider>>& provs) {
+    manifest result;
+    // Index into _entries for each provider we have seen
+    std::map<std::shared_ptr<provider>, size_t> index;
+    std::set<std::pair<std::string, std::string>> seen;
+
+    try {
+      json_container doc(text);
+      auto rsrcs = doc.get<std::vector<json_container>>("resources");
+      for (const auto& js : rsrcs) {
+        if (! js.includes("name") || ! js.includes({ "ral", "type" })) {
+          return error(_("every resource needs a 'name' and a 'ral' entry with its 'type'"));
+        }
+        auto name = js.get<std::string>("name");
+        // A provider, when given, picks one of several for the same type
+        auto prov_name = js.includes({ "ral", "provider" })
+          ? js.get<std::string>({ "ral", "provider" })
+          : js.get<std::string>({ "ral", "type" });
+
+        auto opt_prov = ral::find_provider(prov_name, provs);
+        if (opt_prov == boost::none) {
+          return error(_("unknown provider: '{1}'", prov_name));
+        }
+        auto& prov = *opt_prov;
+
+        if (! seen.insert({ prov->qname(), name }).second) {
+          return error(_("{1}[{2}] is listed more than once",
+                         prov->qname(), name));
+        }
+
+        auto should = prov->create(name);
+        for (const auto& k : js.keys()) {
+          if (k == "name" || k == "ral")
+            continue;
+          auto attr = prov->spec()->attr(k);
+          if (! attr) {
+            return error(_("{1}[{2}]: unknown attribute {3}",
+                           prov->qname(), name, k));
+          }
+          auto v = attr->from_json(js, { k });
+          if (! v) {
+            return error(_("{1}[{2}]: {3}",
+                           prov->qname(), name, v.err().detail));
+          }
+          should[k] = v.ok();
+        }
+
+        auto ins = index.insert({ prov, result._entries.size() });
+        if (ins.second) {
+          result._entries.emplace_back(prov, std::vector<resource>());
+        }
+        result._entries[ins.first->second].second.push_back(std::move(should));
+      }
+    } catch (json::data_error& ex) {
+      return error(_("malformed manifest: {1}", ex.what()));
+    }
+    return std::move(result);
+  }
+
+  bool manifest::precedes(const std::string& before,
+                          const std::string& after) {
+    static const std::vector<std::pair<std::string, std::string>> order = {
+      { "group",   "user" },
+      { "package", "service" } };
+    return std::find(order.begin(), order.end(),
+                     std::make_pair(before, after)) != order.end();
+  }
+
+  std::vector<std::vector<size_t>> manifest::lanes() const {
+    auto n = _entries.size();
+
+    std::vector<std::vector<std::string>> paths;
+    for (const auto& e : _entries) {
+      std::vector<std::string> names;
+      for (const auto& rsrc : e.second) {
+        names.push_back(rsrc.name());
+      }
+      auto p = e.first->watch_paths(names);
+      std::sort(p.begin(), p.end());
+      paths.push_back(std::move(p));
+    }
+
+    auto type = [this](size_t i) -> const std::string& {
+      return _entries[i].first->type_name();
+    };
+    auto overlap = [&paths](size_t i, size_t j) {
+      std::vector<std::string> common;
+      std::set_intersection(paths[i].begin(), paths[i].end(),
+                            paths[j].begin(), paths[j].end(),
+                            std::back_inserter(common));
+      return ! common.empty();
+    };
+
+    // Put entries that must not run concurrently into the same lane; a
+    // lane is named by the smallest index in it
+    std::vector<size_t> lane(n);
+    for (size_t i = 0; i < n; i++) {
+      lane[i] = i;
+    }
+    std::function<size_t(size_t)> find = [&lane, &find](size_t i) {
+      return lane[i] == i ? i : (lane[i] = find(lane[i]));
+    };
+    for (size_t i = 0; i < n; i++) {
+      for (size_t j = i + 1; j < n; j++) {
+        if (overlap(i, j) || precedes(type(i), type(j))
+            || precedes(type(j), type(i))) {
+          auto a = find(i), b = find(j);
+          lane[std::max(a, b)] = std::min(a, b);
+        }
+      }
+    }
+
+    std::vector<std::vector<size_t>> result;
+    for (size_t i = 0; i < n; i++) {
+      if (find(i) != i)
+        continue;
+
+      std::vector<size_t> todo;
+      for (size_t j = i; j < n; j++) {
+        if (find(j) == i)
+          todo.push_back(j);
+      }
+
+      // Take entries in manifest order, but never before an entry that
+      // has to precede them
+      std::vector<size_t> ordered;
+      while (! todo.empty()) {
+        auto next = std::find_if(todo.begin(), todo.end(),
+          [&todo, &type](size_t j) {
+            return std::none_of(todo.begin(), todo.end(),
+                                [&type, j](size_t k) {
+                                  return precedes(type(k), type(j));
+                                });
+          });
+        if (next == todo.end()) {
+          next = todo.begin();
+        }
+        ordered.push_back(*next);
+        todo.erase(next);
+      }
+      result.push_back(std::move(ordered));
+    }
+    return result;
+  }
+}
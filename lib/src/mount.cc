@@ -1,7 +1,13 @@
 #include <libral/mount.hpp>
 
+#include <algorithm>
+#include <functional>
+#include <map>
 #include <sstream>
 
+#include <libral/mountinfo.hpp>
+#include <libral/parallel.hpp>
+
 #include <leatherman/locale/locale.hpp>
 
 using namespace leatherman::locale;
@@ -15,11 +21,9 @@ namespace libral {
 #include "mount.yaml"
       ;
 
-    auto aug = env.augeas({ { "Mount_Fstab.lns", "/etc/fstab" },
-                            { "Mount_Fstab.lns", "/etc/mtab"  } });
-    err_ret(aug);
-
-    _aug = aug.ok();
+    // Parsing the files is expensive; wait with it until we are actually
+    // asked to do something
+    _env = env;
 
     _cmd_mount = env.command("mount");
     _cmd_umount = env.command("umount");
@@ -27,15 +31,73 @@ namespace libral {
     return env.parse_spec("mount", desc);
   }
 
-  aug::node mount_provider::base(const update &upd) {
-    if (upd.present()) {
-      auto res =
-        _aug->make_node("/files/etc/fstab/*[file = '" + upd.name() + "']");
-      res.resolve();
-      return res;
+  result<void> mount_provider::load() {
+    if (! _aug) {
+      // We only need augeas for /etc/fstab; what is mounted comes from
+      // /proc/self/mountinfo
+      auto aug = _env->augeas({ { "Mount_Fstab.lns", "/etc/fstab" } });
+      err_ret(aug);
+
+      _aug = aug.ok();
     } else {
-      return _aug->make_node_seq_next("/files/etc/fstab");
+      // Only rereads /etc/fstab if it changed
+      err_ret( _aug->load() );
+    }
+    return result<void>();
+  }
+
+  result<boost::optional<provider::token>> mount_provider::state_token() {
+    err_ret( load() );
+
+    // What is mounted can change without any file changing, so the
+    // mount table is part of our state
+    auto mountinfo = _env->read("/proc/self/mountinfo");
+    err_ret( mountinfo );
+
+    token tok = std::hash<std::string>()(mountinfo.ok());
+    tok ^= _aug->generation() + 0x9e3779b97f4a7c15ULL + (tok << 6) + (tok >> 2);
+    return boost::optional<token>(tok);
+  }
+
+  std::vector<std::string>
+  mount_provider::watch_paths(const std::vector<std::string>& names) const {
+    return { "/etc/fstab", "/proc/self/mountinfo" };
+  }
+
+  result<std::vector<aug::node>> mount_provider::entries() {
+    auto nodes = _aug->match("/files/etc/fstab/*[label() != '#comment']");
+    err_ret( nodes );
+
+    _paths.clear();
+    for (const auto& node : nodes.ok()) {
+      auto name = node["file"];
+      err_ret(name);
+
+      if (name.ok()) {
+        _paths[**name] = node.path();
+      } else {
+        // Can't happen, the lens makes sure we always have a 'file' entry
+        return error(_("Missing file/mountpoint"));
+      }
+    }
+    _index_gen = _aug->generation();
+    return nodes;
+  }
+
+  result<aug::node> mount_provider::base(const update &upd) {
+    // The handle is shared with other providers, which might have
+    // reloaded or saved it since we built the index
+    if (! _index_gen || *_index_gen != _aug->generation()) {
+      err_ret( entries() );
+    }
+
+    auto& path = _paths[upd.name()];
+    if (path.empty()) {
+      auto node = _aug->make_node_seq_next("/files/etc/fstab");
+      path = node.path();
+      return node;
     }
+    return _aug->make_node(path);
   }
 
   /**
@@ -64,53 +126,71 @@ namespace libral {
   mount_provider::get(context &ctx,
                       const std::vector<std::string>& names,
                       const resource::attributes& config) {
-    std::map<std::string, resource> resources;
+    std::vector<resource> result;
+    std::unordered_map<std::string, size_t> by_name;
 
-    auto nodes = _aug->match("/files/etc/fstab/*[label() != '#comment']");
-    if (!nodes) return nodes.err();
+    err_ret( load() );
 
-    for(const auto& node : nodes.ok()) {
-      auto name = node["file"];
-      err_ret(name);
+    if (! _fstab_gen || *_fstab_gen != _aug->generation()) {
+      auto nodes = entries();
+      if (!nodes) return nodes.err();
+
+      _fstab_cache.clear();
+      for(const auto& node : nodes.ok()) {
+        auto name = node["file"];
+        err_ret(name);
 
-      if (name.ok()) {
         auto r = make(**name, node, "unmounted");
         err_ret(r);
 
-        resources.emplace(**name, std::move(*r));
-      } else {
-        // Can't happen, the lens makes sure we always have a 'file' entry
-        return error(_("Missing file/mountpoint"));
+        _fstab_cache.push_back(std::move(*r));
       }
+      _fstab_gen = _aug->generation();
     }
 
-    nodes = _aug->match("/files/etc/mtab/*[label() != '#comment']");
-    if (!nodes) return nodes.err();
+    for (const auto& rsrc : _fstab_cache) {
+      if (by_name.emplace(rsrc.name(), result.size()).second) {
+        result.push_back(rsrc);
+      }
+    }
 
-    for(const auto& node : nodes.ok()) {
-      auto name = node["file"];
-      err_ret(name);
+    // Everything before this index in result comes from fstab
+    auto in_fstab = result.size();
 
-      if (name.ok()) {
-        auto rsrc_iter = resources.find(*name.ok());
-        if (rsrc_iter != resources.end()) {
-          rsrc_iter->second["ensure"] = "mounted";
-        } else {
-          auto r = make(*name.ok(), node, "ghost");
-          err_ret(r);
-
-          resources.emplace(**name, std::move(*r));
-        }
+    auto mountinfo = _env->read("/proc/self/mountinfo");
+    err_ret( mountinfo );
+
+    for (auto& mnt : mountinfo::parse(mountinfo.ok())) {
+      auto it = by_name.find(mnt.mountpoint);
+      if (it != by_name.end()) {
+        // Mounts stacked on top of a ghost stay ghosts
+        if (it->second < in_fstab)
+          result[it->second]["ensure"] = "mounted";
       } else {
-        // Can't happen, the lens makes sure we always have a 'file' entry
-        return error(_("Missing file/mountpoint"));
+        auto rsrc = create(mnt.mountpoint);
+        rsrc["device"] = std::move(mnt.device);
+        rsrc["fstype"] = std::move(mnt.fstype);
+        rsrc["options"] = std::move(mnt.options);
+        rsrc["dump"] = "0";
+        rsrc["pass"] = "0";
+        rsrc["ensure"] = "ghost";
+        rsrc["target"] = "/etc/fstab";
+
+        by_name.emplace(mnt.mountpoint, result.size());
+        result.push_back(std::move(rsrc));
       }
     }
 
-    std::vector<resource> result;
-    for (auto pair = resources.begin(); pair != resources.end(); ++pair) {
-      result.push_back(std::move(pair->second));
-    }
+    // Whether a mount from fstab is mounted is only known now
+    result.erase(std::remove_if(result.begin(), result.end(),
+                                [&ctx](const resource& r) {
+                                  return ! ctx.admits(r);
+                                }), result.end());
+
+    std::sort(result.begin(), result.end(),
+              [](const resource& a, const resource& b) {
+                return a.name() < b.name();
+              });
     return std::move(result);
   }
 
@@ -123,7 +203,9 @@ namespace libral {
       }
     }
 
-    auto bs = base(upd);
+    auto rbs = base(upd);
+    err_ret( rbs );
+    auto bs = rbs.ok();
 
     err_ret( bs.erase() );
     err_ret( bs.set("spec", upd["device"]) );
@@ -137,14 +219,32 @@ namespace libral {
   result<void>
   mount_provider::set(context &ctx,
                       const updates& upds) {
-    for (auto upd : upds) {
-      err_ret( set(ctx, upd) );
+    err_ret( load() );
+
+    // Plan: make all the edits to fstab in the augeas tree and figure out
+    // what needs to be unmounted and mounted
+    std::vector<std::string> umounts, mounts;
+    // What is mounted on each mountpoint now, and what will be mounted
+    std::map<std::string, std::string> old_devices, new_devices;
+    for (const auto& upd : upds) {
+      err_ret( plan(ctx, upd, umounts, mounts) );
+      auto old_dev = upd.is.lookup<std::string>("device", "");
+      old_devices[upd.name()] = old_dev;
+      new_devices[upd.name()] = upd.should.lookup<std::string>("device", old_dev);
     }
-    return flush();
+
+    // Apply: write fstab once, then unmount before mounting, since
+    // mounting might depend on something else being unmounted first
+    err_ret( flush() );
+    auto lim = ctx.limits_for("set");
+    err_ret( run_by_depth(*_cmd_umount, umounts, old_devices, true, lim) );
+    return run_by_depth(*_cmd_mount, mounts, new_devices, false, lim);
   }
 
   result<void>
-  mount_provider::set(context &ctx, const update &upd) {
+  mount_provider::plan(context &ctx, const update &upd,
+                       std::vector<std::string>& umounts,
+                       std::vector<std::string>& mounts) {
     changes& changes = ctx.changes_for(upd.name());
 
     /* Possible values for ensure:
@@ -163,6 +263,7 @@ namespace libral {
 
     auto state = upd.is.lookup<std::string>("ensure", "absent");
     auto ensure = upd.should.lookup<std::string>("ensure", state);
+    bool is_mounted = (state != "unmounted" && state != "absent");
 
     changes.add("ensure", upd);
 
@@ -171,16 +272,19 @@ namespace libral {
       err_ret( update_fstab(upd, changes) );
     } else if (ensure == "absent") {
       // unmount, remove from fstab
-      err_ret( unmount(upd.name(), state) );
+      if (is_mounted)
+        umounts.push_back(upd.name());
       err_ret( remove_from_fstab(upd) );
     } else if (ensure == "unmounted") {
       // unmount, make sure in fstab
-      err_ret( unmount(upd.name(), state) );
+      if (is_mounted)
+        umounts.push_back(upd.name());
       err_ret( update_fstab(upd, changes) );
     } else if (ensure == "mounted") {
       // mount, make sure in fstab
       err_ret( update_fstab(upd, changes) );
-      err_ret( mount(upd.name(), state) );
+      if (state != "mounted")
+        mounts.push_back(upd.name());
     } else {
       return error(_("ensure has illegal value '{1}'", ensure));
     }
@@ -195,23 +299,112 @@ namespace libral {
 
   result<void>
   mount_provider::remove_from_fstab(const update &upd) {
-    return base(upd).rm();
-  }
+    if (! _index_gen || *_index_gen != _aug->generation()) {
+      err_ret( entries() );
+    }
 
-  result<void>
-  mount_provider::unmount(const std::string& name, const std::string& state) {
-    err_ret(flush());
-    if (state != "unmounted" && state != "absent") {
-      return _cmd_umount->run({ name });
+    auto it = _paths.find(upd.name());
+    if (it == _paths.end() || it->second.empty()) {
+      // Not in fstab, nothing to remove
+      return result<void>();
     }
+    err_ret( _aug->make_node(it->second).rm() );
+    _paths.erase(it);
     return result<void>();
   }
 
+  /* The number of directories between the root and mountpoint; '/' has
+     depth 0 */
+  static size_t depth(const std::string& mountpoint) {
+    auto end = mountpoint.find_last_not_of('/');
+    if (end == std::string::npos)
+      return 0;
+    return std::count(mountpoint.begin(), mountpoint.begin() + end + 1, '/');
+  }
+
+  /* True if path is mountpoint or lies underneath it */
+  static bool is_under(const std::string& path, const std::string& mountpoint) {
+    auto end = mountpoint.find_last_not_of('/');
+    if (end == std::string::npos)
+      return ! path.empty() && path[0] == '/';
+    auto len = end + 1;
+    return path.compare(0, len, mountpoint, 0, len) == 0
+      && (path.size() == len || path[len] == '/');
+  }
+
+  /* The most mount or umount commands we run at the same time */
+  static const unsigned int max_jobs = 8;
+
+  /**
+   * Runs cmd on each of the mountpoints, grouped by how deep they are in
+   * the filesystem, deepest group first if deepest_first is true and
+   * shallowest first otherwise. Mountpoints of the same depth can not be
+   * nested inside each other, and are processed in parallel, at most
+   * max_jobs at a time.
+   *
+   * That is not safe for a mountpoint whose device, as given in devices,
+   * is a path underneath another of the mountpoints, like a bind or loop
+   * mount of a file on a filesystem mounted in the same batch. Such
+   * mountpoints are left out of the groups and processed one at a time,
+   * in the order in which they are listed, after all the groups; if
+   * deepest_first is true, they are processed in reverse order before
+   * all the groups instead. Each command is subject to lim.
+   */
   result<void>
-  mount_provider::mount(const std::string& name, const std::string& state) {
-    err_ret(flush());
-    if (state != "mounted") {
-      return _cmd_mount->run({ name });
+  mount_provider::run_by_depth(command& cmd,
+                               const std::vector<std::string>& mountpoints,
+                               const std::map<std::string, std::string>& devices,
+                               bool deepest_first, const limits& lim) {
+    std::map<size_t, std::vector<std::string>> groups;
+    std::vector<std::string> dependent;
+    for (const auto& mp : mountpoints) {
+      auto dev = devices.find(mp);
+      bool depends = dev != devices.end()
+        && std::any_of(mountpoints.begin(), mountpoints.end(),
+                       [&mp, &dev](const std::string& other) {
+                         return other != mp && is_under(dev->second, other);
+                       });
+      if (depends) {
+        dependent.push_back(mp);
+      } else {
+        groups[depth(mp)].push_back(mp);
+      }
+    }
+
+    // Upload the command before we fan out, so that the threads below
+    // only ever read cmd
+    if (! mountpoints.empty()) {
+      err_ret( cmd.upload() );
+    }
+
+    auto run_group = [&cmd, &lim](const std::vector<std::string>& group)
+      -> result<void> {
+      // Run all of them, even if one fails, and report the first failure
+      std::vector<result<void>> runs(group.size());
+      parallel_for(group.size(), max_jobs,
+                   [&cmd, &group, &runs, &lim](size_t i) {
+          runs[i] = cmd.run({ group[i] }, lim);
+        });
+      for (auto& run : runs) {
+        err_ret( run );
+      }
+      return result<void>();
+    };
+
+    if (deepest_first) {
+      for (auto it = dependent.rbegin(); it != dependent.rend(); ++it) {
+        err_ret( cmd.run({ *it }, lim) );
+      }
+      for (auto it = groups.rbegin(); it != groups.rend(); ++it) {
+        err_ret( run_group(it->second) );
+      }
+    } else {
+      for (auto it = groups.begin(); it != groups.end(); ++it) {
+        err_ret( run_group(it->second) );
+      }
+      for (const auto& mp : dependent) {
+        err_ret( cmd.run({ mp }, lim) );
+      }
     }
     return result<void>();
   }
@@ -0,0 +1,116 @@
+#include <libral/mountinfo.hpp>
+
+#include <boost/utility/string_ref.hpp>
+
+namespace libral { namespace mountinfo {
+
+  using string_ref = boost::string_ref;
+
+  /* Return the next space-separated field from line and remove it from
+     line */
+  static string_ref next_field(string_ref& line) {
+    while (! line.empty() && line.front() == ' ')
+      line.remove_prefix(1);
+    auto pos = line.find(' ');
+    auto field = line.substr(0, pos);
+    line.remove_prefix(field.size());
+    return field;
+  }
+
+  static bool is_octal(char c) {
+    return c >= '0' && c <= '7';
+  }
+
+  /* Decode the octal escapes the kernel uses for space, tab, newline and
+     backslash in paths; only copy character by character if there are
+     any */
+  static std::string unescape(string_ref s) {
+    if (s.find('\\') == string_ref::npos) {
+      return s.to_string();
+    }
+
+    std::string result;
+    result.reserve(s.size());
+    for (size_t i = 0; i < s.size(); i++) {
+      if (s[i] == '\\' && i + 3 < s.size() &&
+          is_octal(s[i+1]) && is_octal(s[i+2]) && is_octal(s[i+3])) {
+        result.push_back(static_cast<char>((s[i+1] - '0') * 64
+                                           + (s[i+2] - '0') * 8
+                                           + (s[i+3] - '0')));
+        i += 3;
+      } else {
+        result.push_back(s[i]);
+      }
+    }
+    return result;
+  }
+
+  /* Combine the per-mount options and the super options the way the kernel
+     does for /proc/mounts: the per-mount options come first, followed by
+     those super options that they do not already contain. The filesystem
+     is read-only if either of them says 'ro' */
+  static std::string merge_options(string_ref mnt, string_ref super) {
+    auto result = mnt.to_string();
+    auto has = [&mnt](string_ref opt) {
+      string_ref rest = mnt;
+      while (! rest.empty()) {
+        auto comma = rest.find(',');
+        if (rest.substr(0, comma) == opt)
+          return true;
+        rest.remove_prefix(comma == string_ref::npos ? rest.size() : comma + 1);
+      }
+      return false;
+    };
+
+    while (! super.empty()) {
+      auto comma = super.find(',');
+      auto opt = super.substr(0, comma);
+      super.remove_prefix(comma == string_ref::npos ? super.size() : comma + 1);
+
+      if (opt.empty() || opt == "rw" || has(opt))
+        continue;
+      if (opt == "ro") {
+        if (mnt.starts_with("rw") && (mnt.size() == 2 || mnt[2] == ','))
+          result.replace(0, 2, "ro");
+        continue;
+      }
+      result += result.empty() ? "" : ",";
+      result.append(opt.data(), opt.size());
+    }
+    return result;
+  }
+
+  std::vector<entry> parse(const std::string& text) {
+    std::vector<entry> entries;
+    string_ref rest(text);
+
+    while (! rest.empty()) {
+      auto eol = rest.find('\n');
+      auto line = rest.substr(0, eol);
+      rest.remove_prefix(eol == string_ref::npos ? rest.size() : eol + 1);
+
+      // mount id, parent id, major:minor, root
+      for (int i=0; i < 4; i++)
+        next_field(line);
+      auto mountpoint = next_field(line);
+      auto options = next_field(line);
+      // Optional fields, terminated by a single '-'
+      string_ref field;
+      do {
+        field = next_field(line);
+      } while (! field.empty() && field != "-");
+      auto fstype = next_field(line);
+      auto device = next_field(line);
+      auto super = next_field(line);
+
+      if (mountpoint.empty() || fstype.empty() || device.empty())
+        continue;
+
+      entries.push_back({ unescape(mountpoint), unescape(device),
+                          fstype.to_string(),
+                          merge_options(options, super) });
+    }
+    return entries;
+  }
+
+} }
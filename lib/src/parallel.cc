@@ -0,0 +1,52 @@
+#include <libral/parallel.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace libral {
+
+  void parallel_for(size_t n, unsigned int jobs,
+                    const std::function<void(size_t)>& fn) {
+    if (jobs == 0) {
+      jobs = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (jobs > n) {
+      jobs = n;
+    }
+
+    std::atomic<size_t> next { 0 };
+    std::mutex mutex;
+    std::exception_ptr failure;
+
+    // Each thread keeps taking the next index until there are none left,
+    // so that one slow call does not hold up the ones queued behind it
+    auto work = [&]() {
+      for (size_t i = next++; i < n; i = next++) {
+        try {
+          fn(i);
+        } catch (...) {
+          std::lock_guard<std::mutex> lock(mutex);
+          if (! failure)
+            failure = std::current_exception();
+        }
+      }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned int t = 1; t < jobs; t++) {
+      pool.emplace_back(work);
+    }
+    work();
+    for (auto& t : pool) {
+      t.join();
+    }
+
+    if (failure) {
+      std::rethrow_exception(failure);
+    }
+  }
+}
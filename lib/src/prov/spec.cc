@@ -11,12 +11,55 @@ namespace libral { namespace prov {
 
   spec::spec(const std::string& name, const std::string& type,
              const std::string& desc, const std::string& invoke,
-             bool suitable,
+             bool suitable, std::set<std::string>&& batch, bool filter,
+             std::map<std::string, unsigned int>&& timeouts,
              attr_spec_map&& attr_specs)
     : _name(name), _type(type), _desc(desc), _invoke(invoke),
       _qname(make_qname(name, type)), _suitable(suitable),
+      _batch(std::move(batch)), _filter(filter), _timeouts(std::move(timeouts)),
       _attr_specs(std::move(attr_specs)) { };
 
+  static const std::string default_action = "default";
+
+  unsigned int spec::timeout(const std::string& action) const {
+    auto it = _timeouts.find(action);
+    if (it == _timeouts.end()) {
+      it = _timeouts.find(default_action);
+    }
+    return it == _timeouts.end() ? 0 : it->second;
+  }
+
+  /* Read the 'timeout' entry, which is either a number of seconds for all
+     actions, or a map from action names (or 'default') to seconds */
+  static result<void>
+  read_timeouts(mruby& mrb, mrb_value node,
+                std::map<std::string, unsigned int>& timeouts) {
+    auto seconds = [](mrb_value v) -> result<unsigned int> {
+      if (! mrb_fixnum_p(v) || mrb_fixnum(v) < 0) {
+        return error(_("timeouts in 'provider.timeout' must be a number of seconds"));
+      }
+      return static_cast<unsigned int>(mrb_fixnum(v));
+    };
+
+    if (mrb_hash_p(node)) {
+      auto keys = mrb.hash_keys(node);
+      for (int i=0; i < mrb.ary_len(keys); i++) {
+        auto key = ary_elt(keys, i);
+        if (! mrb_string_p(key)) {
+          return error(_("the keys in 'provider.timeout' must be action names"));
+        }
+        auto secs = seconds(mrb.hash_get(node, key));
+        err_ret( secs );
+        timeouts[mrb.as_string(key)] = secs.ok();
+      }
+    } else {
+      auto secs = seconds(node);
+      err_ret( secs );
+      timeouts[default_action] = secs.ok();
+    }
+    return result<void>();
+  }
+
   boost::optional<const attr::spec&>
   spec::attr(const std::string& name) const {
     auto it = _attr_specs.find(name);
@@ -67,6 +110,36 @@ namespace libral { namespace prov {
     auto type = mrb->hash_get_string(prov_node, "type");
     auto desc = mrb->hash_get_string(prov_node, "desc");
 
+    std::set<std::string> batch;
+    auto batch_node = mrb->hash_get(prov_node, "batch");
+    if (! mrb_nil_p(batch_node)) {
+      if (! mrb_array_p(batch_node)) {
+        return error(_("expected 'provider.batch' to be an array of action names"));
+      }
+      for (int i=0; i < mrb->ary_len(batch_node); i++) {
+        auto action = ary_elt(batch_node, i);
+        if (! mrb_string_p(action)) {
+          return error(_("the entries in 'provider.batch' must all be strings"));
+        }
+        batch.insert(mrb->as_string(action));
+      }
+    }
+
+    bool filter = false;
+    auto filter_node = mrb->hash_get(prov_node, "filter");
+    if (! mrb_nil_p(filter_node)) {
+      if (! mrb->bool_p(filter_node)) {
+        return error(_("expected 'provider.filter' to be either true or false"));
+      }
+      filter = mrb_bool(filter_node);
+    }
+
+    std::map<std::string, unsigned int> timeouts;
+    auto timeout_node = mrb->hash_get(prov_node, "timeout");
+    if (! mrb_nil_p(timeout_node)) {
+      err_ret( read_timeouts(*mrb, timeout_node, timeouts) );
+    }
+
     auto attrs_node = mrb->hash_get(prov_node, "attributes");
     if (mrb_nil_p(attrs_node)) {
       return error(_("could not find entry 'provider.attributes' in YAML"));
@@ -108,7 +181,59 @@ namespace libral { namespace prov {
 
       suitable = s.ok();
     }
-    return spec(name, type, desc, invoke, suitable, std::move(attr_specs));
+    return spec(name, type, desc, invoke, suitable, std::move(batch),
+                filter, std::move(timeouts), std::move(attr_specs));
+  }
+
+  static const std::string op_not = "not ";
+
+  /* The name of the command in an entry in 'suitable.commands', which
+     might require that the command be absent with 'not CMD' */
+  static std::string command_name(const std::string& entry, bool& negate) {
+    negate = (entry.find(op_not) == 0);
+    if (! negate)
+      return entry;
+    auto pos = entry.find_first_not_of(" \t\n", op_not.length());
+    return pos == std::string::npos ? "" : entry.substr(pos);
+  }
+
+  std::vector<std::string> spec::commands(const std::string& yaml) {
+    std::vector<std::string> cmds;
+
+    auto mrb = mruby::open();
+    if (mrb.is_err()) {
+      return cmds;
+    }
+
+    struct RClass *yaml_class = mrb->module_get("YAML");
+    auto hash = mrb->funcall(yaml_class, "load", yaml);
+    if (! hash || ! mrb_hash_p(*hash)) {
+      return cmds;
+    }
+
+    auto prov_node = mrb->hash_get(*hash, "provider");
+    if (! mrb_hash_p(prov_node)) {
+      return cmds;
+    }
+    auto suitable = mrb->hash_get(prov_node, "suitable");
+    if (! mrb_hash_p(suitable)) {
+      return cmds;
+    }
+    auto cmd_nodes = mrb->hash_get(suitable, "commands");
+    if (! mrb_array_p(cmd_nodes)) {
+      return cmds;
+    }
+
+    for (int i=0; i < mrb->ary_len(cmd_nodes); i++) {
+      auto mrb_cmd = ary_elt(cmd_nodes, i);
+      if (mrb_string_p(mrb_cmd)) {
+        bool negate;
+        auto cmd = command_name(mrb->as_string(mrb_cmd), negate);
+        if (! cmd.empty())
+          cmds.push_back(cmd);
+      }
+    }
+    return cmds;
   }
 
   std::string
@@ -120,7 +245,6 @@ namespace libral { namespace prov {
   read_suitable(const environment&env,
                 mruby& mrb, mrb_value& prov_node,
                 const std::string& prov_name) {
-    static const std::string op_not = "not ";
     mrb_value suitable = mrb.hash_get(prov_node, "suitable");
 
     if (mrb_nil_p(suitable)) {
@@ -141,12 +265,11 @@ namespace libral { namespace prov {
           if (! mrb_string_p(mrb_cmd)) {
             return error(_("provider {1}: the entries in 'suitable.commands' must all be strings", prov_name));
           }
-          auto cmd = mrb.as_string(mrb_cmd);
-          size_t pos = 0;
-          if (cmd.find(op_not) == 0) {
+          bool negate;
+          auto cmd = command_name(mrb.as_string(mrb_cmd), negate);
+          if (negate) {
             // check that command is not there
-            pos = cmd.find_first_not_of(" \t\n", op_not.length());
-            if (!env.which(cmd.substr(pos)).empty()) {
+            if (!env.which(cmd).empty()) {
               return false;
             }
           } else {
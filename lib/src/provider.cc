@@ -1,4 +1,7 @@
 #include <libral/provider.hpp>
+#include <libral/trace.hpp>
+
+#include <algorithm>
 
 #include <leatherman/locale/locale.hpp>
 
@@ -7,16 +10,59 @@ using namespace leatherman::locale;
 namespace libral {
 
   result<std::vector<resource>>
-  provider::get(const std::vector<std::string>& names) {
+  provider::get(const std::vector<std::string>& names, const limits& lim,
+                const std::vector<std::string>& attrs,
+                const filter& filt) {
+    trace::span span("provider.get", qname());
+    for (const auto& a : attrs) {
+      if (! spec()->attr(a)) {
+        return error(_("{1}: unknown attribute {2}", qname(), a));
+      }
+    }
+    for (const auto& pred : filt.predicates()) {
+      if (pred.attr != "name" && ! spec()->attr(pred.attr)) {
+        return error(_("{1}: unknown attribute {2}", qname(), pred.attr));
+      }
+    }
+
     resource::attributes config;
-    context ctx(shared_from_this());
+    context ctx(shared_from_this(), lim, attrs, filt);
+
+    auto rsrcs = get(ctx, names, config);
+    if (! rsrcs)
+      return rsrcs;
+
+    // Providers only have to skip resources that do not match the filter
+    // when that is cheap for them; drop the ones they returned anyway
+    if (! filt.empty()) {
+      auto& v = rsrcs.ok();
+      v.erase(std::remove_if(v.begin(), v.end(),
+                             [&filt](const resource& r) {
+                               return ! filt.matches(r);
+                             }), v.end());
+    }
+    if (attrs.empty())
+      return rsrcs;
 
-    return get(ctx, names, config);
+    // Not every provider skips the attributes that were not asked for;
+    // make sure callers get the same thing from all of them
+    for (auto& rsrc : rsrcs.ok()) {
+      std::vector<std::string> unwanted;
+      for (const auto& a : rsrc.attrs()) {
+        if (! ctx.wants(a.first))
+          unwanted.push_back(a.first);
+      }
+      for (const auto& a : unwanted) {
+        rsrc.erase(a);
+      }
+    }
+    return rsrcs;
   }
 
   result<boost::optional<resource>>
-  provider::find(const std::string &name) {
-    auto rsrcs = get({ name });
+  provider::find(const std::string &name, const limits& lim,
+                 const std::vector<std::string>& attrs) {
+    auto rsrcs = get({ name }, lim, attrs);
     err_ret(rsrcs);
 
     boost::optional<resource> res;
@@ -34,8 +80,9 @@ namespace libral {
   }
 
   result<std::vector<std::pair<update, changes>>>
-  provider::set(const std::vector<resource>& shoulds) {
-    context ctx(shared_from_this());
+  provider::set(const std::vector<resource>& shoulds, const limits& lim) {
+    trace::span span("provider.set", qname());
+    context ctx(shared_from_this(), lim);
     resource::attributes config;
 
     // get the resoures mentioned in should
@@ -73,6 +120,21 @@ namespace libral {
     return res;
   }
 
+  result<boost::optional<provider::token>> provider::state_token() {
+    return boost::optional<token>();
+  }
+
+  result<bool> provider::unchanged_since(token tok) {
+    auto cur = state_token();
+    err_ret( cur );
+    return cur.ok() && *cur.ok() == tok;
+  }
+
+  std::vector<std::string>
+  provider::watch_paths(const std::vector<std::string>& names) const {
+    return { };
+  }
+
   result<value> provider::parse(const std::string& name, const std::string& v) {
     if (!_spec) {
       return error(_("internal error: spec was not initialized"));
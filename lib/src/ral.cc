@@ -14,6 +14,7 @@
 #include <libral/simple_provider.hpp>
 #include <libral/json_provider.hpp>
 #include <libral/target/base.hpp>
+#include <libral/trace.hpp>
 
 #include <leatherman/file_util/directory.hpp>
 #include <leatherman/logging/logging.hpp>
@@ -124,6 +125,7 @@ namespace libral {
   bool ral::init_provider(environment &env,
                           const std::string& name,
                           std::shared_ptr<provider>& prov) {
+    trace::span span("provider.prepare", name);
     auto res = prov->prepare(env);
     if (res.is_ok()) {
       if (prov->spec()->suitable()) {
@@ -138,9 +140,50 @@ namespace libral {
   }
 
   std::vector<std::shared_ptr<provider>> ral::providers(void) {
+    trace::span span("ral.providers");
     std::vector<std::shared_ptr<provider>> result;
     environment env = make_env();
 
+    // Commands might have come or gone since the last time we looked
+    _target->forget_commands();
+
+    // Collect the metadata of external providers first, so that we know
+    // all the commands that providers will look for
+    struct external {
+      std::string path;
+      command::uptr cmd;
+      std::string metadata;
+    };
+    std::vector<external> externals;
+
+    auto cb = [&externals,&env,this](std::string const &path) {
+      auto cmd = env.script(path);
+      auto res = get_metadata(*cmd, path);
+
+      if (! res) {
+        LOG_WARNING("provider[{1}]: {2}", path, res.err().detail);
+        return true;
+      }
+      externals.push_back({ path, std::move(cmd), std::move(*res) });
+      return true;
+    };
+
+    for (auto dir : _data_dirs) {
+      leatherman::file_util::each_file(dir + "/providers", cb , "\\.prov$");
+    }
+
+    if (! _local) {
+      // Every lookup of a command is a round trip to the target; do all
+      // of them at once. The builtin providers only look for commands
+      // on remote targets for mounting
+      std::vector<std::string> cmds = { "mount", "umount" };
+      for (const auto& ext : externals) {
+        auto ext_cmds = prov::spec::commands(ext.metadata);
+        cmds.insert(cmds.end(), ext_cmds.begin(), ext_cmds.end());
+      }
+      _target->which_all(cmds);
+    }
+
     std::vector<std::pair<std::string, provider *>> builtin = {
       { "mount", new mount_provider() },
       { "user",  new user_provider()  },
@@ -156,21 +199,15 @@ namespace libral {
       }
     }
 
-    // Find external providers
-    auto cb = [&result,&env,this](std::string const &path) {
-      auto cmd = env.script(path);
-      auto res = get_metadata(*cmd, path);
-
-      if (! res) {
-        LOG_WARNING("provider[{1}]: {2}", path, res.err().detail);
-        return true;
-      }
+    for (auto& ext : externals) {
+      const auto& path = ext.path;
+      auto& cmd = ext.cmd;
 
       auto name = fs::path(cmd->path()).filename().stem().native();
-      auto spec = env.parse_spec(name, *res);
+      auto spec = env.parse_spec(name, ext.metadata);
       if (!spec) {
         LOG_ERROR("provider[{1}]: {2}", path, spec.err().detail);
-        return true;
+        continue;
       }
 
       provider *raw_prov;
@@ -179,9 +216,11 @@ namespace libral {
         raw_prov = new simple_provider(cmd, *spec);
       } else if (invoke == "json") {
         raw_prov = new json_provider(cmd, *spec);
+      } else if (invoke == "persistent") {
+        raw_prov = new json_provider(cmd, *spec, true);
       } else {
-        LOG_ERROR("provider[{1}]: unknown calling convention '{2}', expected 'simple' or 'json'", path, invoke);
-        return true;
+        LOG_ERROR("provider[{1}]: unknown calling convention '{2}', expected 'simple', 'json' or 'persistent'", path, invoke);
+        continue;
       }
 
       auto prov = std::shared_ptr<provider>(raw_prov);
@@ -190,11 +229,6 @@ namespace libral {
                    path, invoke, spec->type_name()));
         result.push_back(std::move(prov));
       }
-      return true;
-    };
-
-    for (auto dir : _data_dirs) {
-      leatherman::file_util::each_file(dir + "/providers", cb , "\\.prov$");
     }
 
     std::sort(result.begin(), result.end(),
@@ -205,11 +239,21 @@ namespace libral {
     return result;
   }
 
+  result<watcher::uptr> ral::watch() {
+    if (! _local) {
+      return error(_("resources can only be watched on the local system"));
+    }
+    return watcher::create();
+  }
+
   boost::optional<std::shared_ptr<provider>>
   ral::find_provider(const std::string& name) {
-    auto provs = providers();
-
+    return find_provider(name, providers());
+  }
 
+  boost::optional<std::shared_ptr<provider>>
+  ral::find_provider(const std::string& name,
+                     const std::vector<std::shared_ptr<provider>>& provs) {
     for (auto& p : provs) {
       // FIXME: We assume that qname is unique amongst all providers, but
       // do not enforce that
@@ -253,9 +297,14 @@ namespace libral {
   }
 
   result<std::string> ral::run_describe(command& cmd) const {
+    trace::span span("provider.describe", cmd.path());
     if (cmd.executable()) {
-      auto res = cmd.execute({ "ral_action=describe" });
+      auto res = cmd.execute({ "ral_action=describe" }, _describe_limits);
       if (!res.success) {
+        if (res.exit_code < 0) {
+          // It was killed because of _describe_limits
+          return error(_("ignored: {1}", res.error));
+        }
         if (res.output.empty()) {
           return error(_("ignored as it exited with status {1}", res.exit_code));
         } else {
@@ -0,0 +1,26 @@
+#include <libral/simple_parser.hpp>
+
+#include <cctype>
+
+namespace libral {
+
+  static simple_parser::string_ref trim(simple_parser::string_ref s) {
+    while (! s.empty() && std::isspace(static_cast<unsigned char>(s.front())))
+      s.remove_prefix(1);
+    while (! s.empty() && std::isspace(static_cast<unsigned char>(s.back())))
+      s.remove_suffix(1);
+    return s;
+  }
+
+  bool simple_parser::split(string_ref line,
+                            string_ref& key, string_ref& value) {
+    line = trim(line);
+    auto pos = line.find(':');
+    if (pos == string_ref::npos) {
+      return false;
+    }
+    key = line.substr(0, pos);
+    value = trim(line.substr(pos+1));
+    return true;
+  }
+}
@@ -1,11 +1,14 @@
 #include <libral/simple_provider.hpp>
 
+#include <algorithm>
 #include <iostream>
 #include <string>
+#include <map>
+#include <set>
 
-#include <boost/algorithm/string.hpp>
 #include <leatherman/execution/execution.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/algorithm/string/join.hpp>
 
 #include <leatherman/locale/locale.hpp>
 
@@ -15,38 +18,66 @@
 
 using namespace leatherman::locale;
 namespace fs = boost::filesystem;
+using string_ref = libral::simple_parser::string_ref;
 
 namespace libral {
 
+  /* Quote s for the shell, so that the provider's 'eval "$@"' turns it
+     back into exactly s */
+  static std::string quote(const std::string& s) {
+    std::string result = "'";
+    for (auto c : s) {
+      if (c == '\'')
+        result += "'\\''";
+      else
+        result += c;
+    }
+    return result + "'";
+  }
+
+  /* Make sure s can go into one 'key: value' line on a batch's stdin;
+     a newline in it would start a line, or a whole block, of its own */
+  static result<void> check_line(const std::string& what,
+                                 const std::string& s) {
+    if (s.find('\n') != std::string::npos) {
+      return error(_("{1} must not contain a newline: '{2}'", what, s));
+    }
+    return result<void>();
+  }
+
   result<void>
   simple_provider::set(context &ctx, const updates& upds) {
+    if (spec()->batch("update")) {
+      return set_batch(ctx, upds);
+    }
+
     for (auto upd : upds) {
       std::vector<std::string> args;
       auto& name = upd.name();
       auto& chgs = ctx.changes_for(name);
       bool  derive = false;
 
-      auto cb = [&name, &chgs, &derive](std::string& key, std::string& value)
+      auto cb = [&name, &chgs, &derive](string_ref key, string_ref value)
         -> result<bool> {
         if (key == "ral_derive") {
           derive = (value == "true");
         } else if (key == "name") {
           if (value != name) {
             return error(_("wrong name changed by update: '{1}' instead of '{2}'",
-                           value, name));
+                           value.to_string(), name));
           }
         } else if (key == "ral_was") {
-          chgs.back().was = value;
+          chgs.back().was = value.to_string();
         } else {
-          chgs.push_back(change(key, value));
+          chgs.push_back(change(key.to_string(), value.to_string()));
         }
         return true;
       };
 
-      args.push_back("name='" + upd.name() + "'");
+      args.push_back("name=" + quote(upd.name()));
       for (auto p : upd.should.attrs()) {
         if (upd.changed(p.first)) {
-          args.push_back(p.first + "='" + p.second.to_string() + "'");
+          args.push_back(p.first + "=" + quote(p.second.to_string()));
         }
       }
       if (args.size() > 1) {
@@ -61,12 +92,87 @@ namespace libral {
     return result<void>();
   }
 
+  result<void>
+  simple_provider::set_batch(context &ctx, const updates& upds) {
+    // Pass the updates on stdin, one block of 'key: value' lines per
+    // resource, each starting with its name
+    std::string inp;
+    std::map<std::string, const update*> pending;
+    for (const auto& upd : upds) {
+      err_ret( check_line(_("{1}: name", qname()), upd.name()) );
+      std::string block = "name: " + upd.name() + "\n";
+      bool changed = false;
+      for (auto p : upd.should.attrs()) {
+        if (upd.changed(p.first)) {
+          auto v = p.second.to_string();
+          err_ret( check_line(_("{1}[{2}]: value of {3}",
+                                qname(), upd.name(), p.first), v) );
+          block += p.first + ": " + v + "\n";
+          changed = true;
+        }
+      }
+      // Only pass resources that actually have changes to make
+      if (changed) {
+        inp += block;
+        pending[upd.name()] = &upd;
+      }
+    }
+
+    if (pending.empty()) {
+      return result<void>();
+    }
+
+    const update *cur = nullptr;
+    changes *chgs = nullptr;
+    std::set<std::string> derive;
+
+    auto cb = [&ctx, &pending, &cur, &chgs, &derive]
+      (string_ref key, string_ref value) -> result<bool> {
+      if (key == "name") {
+        auto name = value.to_string();
+        auto it = pending.find(name);
+        if (it == pending.end()) {
+          return error(_("wrong name changed by update: '{1}' was not part of the batch", name));
+        }
+        cur = it->second;
+        chgs = &ctx.changes_for(name);
+      } else if (cur == nullptr) {
+        return error(_("format error: attribute values must come after the name"));
+      } else if (key == "ral_derive") {
+        if (value == "true")
+          derive.insert(cur->name());
+      } else if (key == "ral_unknown") {
+        return error(_("resource '{1}' does not exist and can not be created",
+                       cur->name()));
+      } else if (key == "ral_was") {
+        if (chgs->empty()) {
+          return error(_("format error: 'ral_was' for '{1}' must follow the attribute that was changed", cur->name()));
+        }
+        chgs->back().was = value.to_string();
+      } else {
+        chgs->push_back(change(key.to_string(), value.to_string()));
+      }
+      return true;
+    };
+
+    auto r = run_action(ctx, "update", cb, { "ral_batch=true" }, &inp);
+    if (!r)
+      return r.err();
+
+    for (const auto& name : derive) {
+      ctx.changes_for(name).maybe_add(*pending[name]);
+    }
+    return result<void>();
+  }
+
   result<std::vector<resource>>
   simple_provider::get(context &ctx,
       const std::vector<std::string>& names,
       const resource::attributes& config) {
     if (names.size() == 1) {
       return find(ctx, names.front());
+    } else if (names.size() > 1 && spec()->batch("find")) {
+      return find_batch(ctx, names);
     } else {
       return instances(ctx);
     }
@@ -75,22 +181,23 @@ namespace libral {
   result<std::vector<resource>>
   simple_provider::find(context& ctx, const std::string &name) {
     std::vector<resource> res;
-    bool unknown;
+    bool unknown = false;
 
-    auto cb = [this, &res, &name, &unknown](std::string key, std::string value) -> result<bool> {
+    auto cb = [this, &res, &unknown](string_ref key, string_ref value)
+      -> result<bool> {
       if (key == "name") {
-        res.push_back(create(value));
-        return true;
+        res.push_back(create(value.to_string()));
+      } else if (res.size() == 0) {
+        return error(_("format error: attribute values must come after the name"));
       } else if (key == "ral_unknown") {
         unknown = true;
-        return true;
       } else {
-        res.back()[key] = value;
-        return true;
+        set_attr(res.back(), key, value);
       }
+      return true;
     };
 
-    auto r = run_action(ctx, "find", cb, { "name='" + name + "'" });
+    auto r = run_action(ctx, "find", cb, { "name=" + quote(name) });
     if (!r) {
       return r.err();
     }
@@ -101,20 +208,60 @@ namespace libral {
     return res;
   }
 
+  result<std::vector<resource>>
+  simple_provider::find_batch(context& ctx,
+                              const std::vector<std::string>& names) {
+    std::vector<resource> res;
+    std::set<std::string> unknown;
+
+    std::string inp;
+    for (const auto& name : names) {
+      err_ret( check_line(_("{1}: name", qname()), name) );
+      inp += "name: " + name + "\n";
+    }
+
+    auto cb = [this, &res, &unknown](string_ref key, string_ref value)
+      -> result<bool> {
+      if (key == "name") {
+        res.push_back(create(value.to_string()));
+      } else if (res.size() == 0) {
+        return error(_("format error: attribute values must come after the name"));
+      } else if (key == "ral_unknown") {
+        unknown.insert(res.back().name());
+      } else {
+        set_attr(res.back(), key, value);
+      }
+      return true;
+    };
+
+    auto r = run_action(ctx, "find", cb, { "ral_batch=true" }, &inp);
+    if (!r) {
+      return r.err();
+    }
+
+    if (! unknown.empty()) {
+      res.erase(std::remove_if(res.begin(), res.end(),
+                               [&unknown](const resource& rsrc) {
+                                 return unknown.count(rsrc.name()) > 0;
+                               }),
+                res.end());
+    }
+    return res;
+  }
+
   result<std::vector<resource>> simple_provider::instances(context& ctx) {
     // run script with ral_action == list
     std::vector<resource> res;
 
-    auto cb = [this, &res](std::string key, std::string value) -> result<bool> {
+    auto cb = [this, &res](string_ref key, string_ref value) -> result<bool> {
       if (key == "name") {
-        res.push_back(create(value));
+        res.push_back(create(value.to_string()));
       } else {
         if (res.size() == 0) {
           return error(_("format error: attribute values must come after the name"));
         }
-        // FIXME: check that KEY is a valid attribute and VALUE is a valid
-        // for the attribute's type
-        res.back()[key] = value;
+        // FIXME: check that VALUE is a valid for the attribute's type
+        set_attr(res.back(), key, value);
       }
       return true;
     };
@@ -125,16 +272,34 @@ namespace libral {
     return res;
   }
 
+  void simple_provider::set_attr(resource& rsrc,
+                                 string_ref key, string_ref value) {
+    rsrc[key.to_string()] = value.to_string();
+  }
+
+  template<typename F>
   result<bool>
   simple_provider::run_action(context& ctx, const std::string& action,
-         std::function<result<bool>(std::string&, std::string&)> entry_cb,
-         std::vector<std::string> args) {
+                              F entry_cb,
+                              std::vector<std::string> args,
+                              const std::string *stdin) {
     int line_cnt = 0;
     bool in_error = false;
     result<bool> rslt = true;
     std::string errmsg;
 
     args.push_back("ral_action=" + action);
+    if ((action == "list" || action == "find") && ! ctx.attrs().empty()) {
+      args.push_back("ral_attrs="
+                     + quote(boost::algorithm::join(ctx.wanted_attrs(), ",")));
+    }
+    if ((action == "list" || action == "find") && spec()->filter()
+        && ! ctx.filter().empty()) {
+      // One condition per line; parse_predicate makes sure they do not
+      // contain newlines themselves
+      auto conds = boost::algorithm::join(ctx.filter().to_strings(), "\n");
+      args.push_back("ral_filter=" + quote(conds));
+    }
     auto err_cb = [&ctx](std::string &line) {
       ctx.log_line(line);
       return true;
@@ -152,16 +317,12 @@ namespace libral {
           rslt = error(errmsg);
         }
       } else {
-        size_t pos = line.find_first_of(":");
-        if (pos == std::string::npos) {
+        string_ref key, value;
+        if (! simple_parser::split(line, key, value)) {
           rslt = error(_("invalid line: '%s'. Expected '<KEY>: <VALUE>' but couldn't find a ':'", line));
-        }
-        auto key = line.substr(0, pos);
-        auto value = line.substr(pos+1);
-        boost::trim(value);
-        if (key == "ral_error") {
+        } else if (key == "ral_error") {
           in_error = true;
-          errmsg = value;
+          errmsg = value.to_string();
         } else {
           auto r = entry_cb(key, value);
           if (r.is_err()) {
@@ -171,8 +332,15 @@ namespace libral {
       }
       return rslt.is_ok();
     };
-    auto r = _cmd->each_line(args, out_cb, err_cb);
-    if (! r && rslt.is_ok()) {
+    auto lim = ctx.limits_for(action);
+    static const std::string no_input;
+    auto res = _cmd->execute(args, stdin ? *stdin : no_input,
+                             out_cb, err_cb, lim);
+    if (! res.success && rslt.is_ok()) {
+      if (! res.error.empty()) {
+        // We were killed because of the limits
+        errmsg = res.error;
+      }
       if (errmsg.empty()) {
         rslt = error(_("Something went wrong running %s ral_action=%s",
                        _cmd->path(), action));
@@ -0,0 +1,478 @@
+#include <libral/snapshot.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <leatherman/file_util/file.hpp>
+#include <leatherman/locale/locale.hpp>
+
+using namespace leatherman::locale;
+
+namespace libral {
+
+  static const char s_magic[8] = { 'R', 'A', 'L', 'S', 'N', 'A', 'P', '\0' };
+  static const size_t s_header_len = sizeof(s_magic) + 4 + 4 + 8;
+
+  enum class tag : uint8_t { none = 0, boolean = 1, string = 2, array = 3 };
+
+  /*
+   * Encoding
+   */
+  static void put_u32(std::string& out, uint32_t v) {
+    for (int i = 0; i < 4; i++) {
+      out.push_back(static_cast<char>((v >> (8 * i)) & 0xff));
+    }
+  }
+
+  static void put_u64(std::string& out, uint64_t v) {
+    for (int i = 0; i < 8; i++) {
+      out.push_back(static_cast<char>((v >> (8 * i)) & 0xff));
+    }
+  }
+
+  static void put_str(std::string& out, const std::string& s) {
+    put_u32(out, s.size());
+    out.append(s);
+  }
+
+  struct put_value_visitor : boost::static_visitor<> {
+    put_value_visitor(std::string& out) : _out(out) { }
+
+    void operator()(const boost::none_t& n) const {
+      _out.push_back(static_cast<char>(tag::none));
+    }
+
+    void operator()(const bool& b) const {
+      _out.push_back(static_cast<char>(tag::boolean));
+      _out.push_back(b ? 1 : 0);
+    }
+
+    void operator()(const std::string& s) const {
+      _out.push_back(static_cast<char>(tag::string));
+      put_str(_out, s);
+    }
+
+    void operator()(const array& ary) const {
+      _out.push_back(static_cast<char>(tag::array));
+      put_u32(_out, ary.size());
+      for (const auto& s : ary) {
+        put_str(_out, s);
+      }
+    }
+
+  private:
+    std::string& _out;
+  };
+
+  static std::string encode_attrs(const resource::attributes& attrs) {
+    // attributes is a std::map, and therefore already sorted by name
+    std::string out;
+    put_u32(out, attrs.size());
+    for (const auto& a : attrs) {
+      put_str(out, a.first);
+      boost::apply_visitor(put_value_visitor(out), a.second);
+    }
+    return out;
+  }
+
+  /*
+   * Decoding. Every read checks that it stays within the data; once a
+   * read has failed, all further reads fail, too
+   */
+  struct reader {
+    reader(const char *data, size_t len) : p(data), end(data + len) { }
+
+    bool take(size_t n) {
+      if (! ok || static_cast<size_t>(end - p) < n) {
+        ok = false;
+        return false;
+      }
+      return true;
+    }
+
+    uint8_t u8() {
+      if (! take(1)) return 0;
+      return static_cast<uint8_t>(*p++);
+    }
+
+    uint32_t u32() {
+      if (! take(4)) return 0;
+      uint32_t v = 0;
+      for (int i = 0; i < 4; i++) {
+        v |= static_cast<uint32_t>(static_cast<uint8_t>(p[i])) << (8 * i);
+      }
+      p += 4;
+      return v;
+    }
+
+    uint64_t u64() {
+      if (! take(8)) return 0;
+      uint64_t v = 0;
+      for (int i = 0; i < 8; i++) {
+        v |= static_cast<uint64_t>(static_cast<uint8_t>(p[i])) << (8 * i);
+      }
+      p += 8;
+      return v;
+    }
+
+    const char *bytes(uint32_t len) {
+      if (! take(len)) return nullptr;
+      auto s = p;
+      p += len;
+      return s;
+    }
+
+    std::string string() {
+      auto len = u32();
+      auto s = bytes(len);
+      return ok ? std::string(s, len) : std::string();
+    }
+
+    const char *p;
+    const char *end;
+    bool ok = true;
+  };
+
+  static bool decode_value(reader& rd, value& v) {
+    switch (static_cast<tag>(rd.u8())) {
+    case tag::none:
+      v = boost::none;
+      break;
+    case tag::boolean:
+      v = (rd.u8() != 0);
+      break;
+    case tag::string:
+      v = rd.string();
+      break;
+    case tag::array: {
+      array ary;
+      auto n = rd.u32();
+      for (uint32_t i = 0; i < n && rd.ok; i++) {
+        ary.push_back(rd.string());
+      }
+      v = ary;
+      break;
+    }
+    default:
+      return false;
+    }
+    return rd.ok;
+  }
+
+  static bool decode_attrs(const char *data, uint32_t len,
+                           resource::attributes& attrs) {
+    reader rd(data, len);
+    auto n = rd.u32();
+    for (uint32_t i = 0; i < n && rd.ok; i++) {
+      auto name = rd.string();
+      if (! decode_value(rd, attrs[name]))
+        return false;
+    }
+    return rd.ok && rd.p == rd.end;
+  }
+
+  /*
+   * Builder
+   */
+  void snapshot::builder::add(const provider& prov,
+                              const std::vector<resource>& rsrcs) {
+    for (const auto& rsrc : rsrcs) {
+      entry e { prov.qname(), rsrc.name(), std::string() };
+      put_str(e.record, prov.type_name());
+      put_str(e.record, e.provider);
+      put_str(e.record, e.name);
+      put_str(e.record, encode_attrs(rsrc.attrs()));
+      _entries.push_back(std::move(e));
+    }
+  }
+
+  std::string snapshot::builder::bytes() const {
+    std::vector<const entry *> sorted;
+    for (const auto& e : _entries) {
+      sorted.push_back(&e);
+    }
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](const entry *a, const entry *b) {
+                       return a->provider < b->provider ||
+                         (a->provider == b->provider && a->name < b->name);
+                     });
+
+    // When the same resource was added more than once, the last one wins
+    std::vector<const entry *> uniq;
+    size_t len = s_header_len;
+    for (const auto e : sorted) {
+      if (! uniq.empty() && uniq.back()->provider == e->provider
+          && uniq.back()->name == e->name) {
+        len -= uniq.back()->record.size() + 8;
+        uniq.pop_back();
+      }
+      uniq.push_back(e);
+      len += e->record.size() + 8;
+    }
+    sorted.swap(uniq);
+
+    std::string out;
+    out.reserve(len);
+    out.append(s_magic, sizeof(s_magic));
+    put_u32(out, version);
+    put_u32(out, sorted.size());
+    put_u64(out, len - 8 * sorted.size());
+
+    for (const auto e : sorted) {
+      out.append(e->record);
+    }
+    uint64_t offset = s_header_len;
+    for (const auto e : sorted) {
+      put_u64(out, offset);
+      offset += e->record.size();
+    }
+    return out;
+  }
+
+  snapshot::uptr snapshot::builder::build() const {
+    uptr snap(new snapshot());
+    snap->_bytes = bytes();
+    snap->_data = snap->_bytes.data();
+    snap->_len = snap->_bytes.size();
+    // We just encoded the data ourselves; it can't be malformed
+    snap->init();
+    return snap;
+  }
+
+  result<void> snapshot::builder::write(const std::string& path) const {
+    try {
+      leatherman::file_util::atomic_write_to_file(bytes(), path);
+    } catch (std::exception& e) {
+      return error(_("failed to write snapshot {1}: {2}", path, e.what()));
+    }
+    return result<void>();
+  }
+
+  /*
+   * Snapshot
+   */
+  snapshot::~snapshot() {
+    if (_map) {
+      munmap(_map, _map_len);
+    }
+  }
+
+  result<snapshot::uptr> snapshot::open(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      return error(_("failed to open snapshot {1}: {2}", path,
+                     strerror(errno)));
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+      auto msg = strerror(errno);
+      close(fd);
+      return error(_("failed to open snapshot {1}: {2}", path, msg));
+    }
+    if (static_cast<size_t>(st.st_size) < s_header_len) {
+      close(fd);
+      return error(_("{1} is not a snapshot", path));
+    }
+
+    uptr snap(new snapshot());
+    snap->_map_len = st.st_size;
+    snap->_map = mmap(nullptr, snap->_map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+    auto map_errno = errno;
+    close(fd);
+    if (snap->_map == MAP_FAILED) {
+      snap->_map = nullptr;
+      return error(_("failed to map snapshot {1}: {2}", path,
+                     strerror(map_errno)));
+    }
+    snap->_data = static_cast<const char *>(snap->_map);
+    snap->_len = snap->_map_len;
+
+    auto r = snap->init();
+    if (! r) {
+      return error(_("{1}: {2}", path, r.err().detail));
+    }
+    return std::move(snap);
+  }
+
+  static int compare(const char *a, uint32_t alen,
+                     const char *b, uint32_t blen) {
+    auto c = memcmp(a, b, std::min(alen, blen));
+    if (c != 0)
+      return c;
+    return (alen < blen) ? -1 : (alen > blen);
+  }
+
+  result<void> snapshot::init() {
+    if (_len < s_header_len || memcmp(_data, s_magic, sizeof(s_magic)) != 0) {
+      return error(_("not a snapshot"));
+    }
+
+    reader hdr(_data + sizeof(s_magic), _len - sizeof(s_magic));
+    auto vers = hdr.u32();
+    if (vers != version) {
+      return error(_("unsupported snapshot version {1}, expected {2}",
+                     vers, version));
+    }
+    _count = hdr.u32();
+    auto index_ofs = hdr.u64();
+    if (index_ofs < s_header_len || index_ofs > _len ||
+        (_len - index_ofs) / 8 < _count) {
+      return error(_("the snapshot index is corrupt"));
+    }
+    _index = _data + index_ofs;
+
+    // Check every record once here, so that at() and diff() can trust
+    // the data
+    reader idx(_index, 8 * static_cast<size_t>(_count));
+    record prev {};
+    for (uint32_t i = 0; i < _count; i++) {
+      auto ofs = idx.u64();
+      if (ofs < s_header_len || ofs >= index_ofs) {
+        return error(_("the snapshot index is corrupt"));
+      }
+      reader rd(_data + ofs, index_ofs - ofs);
+      record rec;
+      for (auto s : { &rec.type, &rec.provider, &rec.name, &rec.attrs }) {
+        s->len = rd.u32();
+        s->data = rd.bytes(s->len);
+      }
+      if (! rd.ok) {
+        return error(_("snapshot record {1} is corrupt", i));
+      }
+      if (i > 0) {
+        auto c = compare(prev.provider.data, prev.provider.len,
+                         rec.provider.data, rec.provider.len);
+        if (c > 0 ||
+            (c == 0 && compare(prev.name.data, prev.name.len,
+                               rec.name.data, rec.name.len) >= 0)) {
+          return error(_("the snapshot index is not sorted"));
+        }
+      }
+      prev = rec;
+    }
+    return result<void>();
+  }
+
+  snapshot::record snapshot::at(size_t i) const {
+    reader idx(_index + 8 * i, 8);
+    auto ofs = idx.u64();
+    reader rd(_data + ofs, _index - (_data + ofs));
+    record rec;
+    for (auto s : { &rec.type, &rec.provider, &rec.name, &rec.attrs }) {
+      s->len = rd.u32();
+      s->data = rd.bytes(s->len);
+    }
+    return rec;
+  }
+
+  std::vector<std::string> snapshot::providers() const {
+    std::vector<std::string> result;
+    for (size_t i = 0; i < _count; i++) {
+      auto rec = at(i);
+      if (result.empty() ||
+          compare(result.back().data(), result.back().size(),
+                  rec.provider.data, rec.provider.len) != 0) {
+        result.emplace_back(rec.provider.data, rec.provider.len);
+      }
+    }
+    return result;
+  }
+
+  /* A difference for a resource that was added or removed, with a change
+   * for each of its attributes */
+  static snapshot::difference
+  whole_difference(snapshot::difference::state what,
+                   const std::string& type, const std::string& provider,
+                   const std::string& name, const char *attrs,
+                   uint32_t attrs_len) {
+    snapshot::difference d { what, type, provider, name, { } };
+    resource::attributes decoded;
+    decode_attrs(attrs, attrs_len, decoded);
+    for (const auto& a : decoded) {
+      if (what == snapshot::difference::state::added) {
+        d.chgs.emplace_back(a.first, a.second);
+      } else {
+        d.chgs.emplace_back(a.first, boost::none, a.second);
+      }
+    }
+    return d;
+  }
+
+  std::vector<snapshot::difference>
+  snapshot::diff(const snapshot& from, const snapshot& to) {
+    using state = difference::state;
+    std::vector<difference> result;
+
+    auto as_string = [](const str& s) { return std::string(s.data, s.len); };
+
+    size_t i = 0, j = 0;
+    while (i < from._count || j < to._count) {
+      int c;
+      record a {}, b {};
+      if (i == from._count) {
+        b = to.at(j);
+        c = 1;
+      } else if (j == to._count) {
+        a = from.at(i);
+        c = -1;
+      } else {
+        a = from.at(i);
+        b = to.at(j);
+        c = compare(a.provider.data, a.provider.len,
+                    b.provider.data, b.provider.len);
+        if (c == 0)
+          c = compare(a.name.data, a.name.len, b.name.data, b.name.len);
+      }
+
+      if (c < 0) {
+        result.push_back(whole_difference(state::removed, as_string(a.type),
+                                          as_string(a.provider),
+                                          as_string(a.name),
+                                          a.attrs.data, a.attrs.len));
+        i++;
+      } else if (c > 0) {
+        result.push_back(whole_difference(state::added, as_string(b.type),
+                                          as_string(b.provider),
+                                          as_string(b.name),
+                                          b.attrs.data, b.attrs.len));
+        j++;
+      } else {
+        // Resources whose attributes are the same byte for byte are
+        // unchanged, and that is the common case
+        if (compare(a.attrs.data, a.attrs.len,
+                    b.attrs.data, b.attrs.len) != 0) {
+          difference d { state::changed, as_string(b.type),
+                         as_string(b.provider), as_string(b.name),
+                         { } };
+          resource::attributes was, is;
+          decode_attrs(a.attrs.data, a.attrs.len, was);
+          decode_attrs(b.attrs.data, b.attrs.len, is);
+          for (const auto& attr : is) {
+            auto old = was.find(attr.first);
+            if (old == was.end()) {
+              d.chgs.emplace_back(attr.first, attr.second);
+            } else if (! (old->second == attr.second)) {
+              d.chgs.emplace_back(attr.first, attr.second, old->second);
+            }
+          }
+          for (const auto& attr : was) {
+            if (is.find(attr.first) == is.end()) {
+              d.chgs.emplace_back(attr.first, boost::none, attr.second);
+            }
+          }
+          result.push_back(std::move(d));
+        }
+        i++;
+        j++;
+      }
+    }
+    return result;
+  }
+}
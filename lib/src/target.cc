@@ -4,8 +4,99 @@
 #include <libral/target/local.hpp>
 #include <libral/target/ssh.hpp>
 
+#include <signal.h>
+
+#include <leatherman/execution/execution.hpp>
+#include <leatherman/locale/locale.hpp>
+
+using namespace leatherman::locale;
+namespace exe = leatherman::execution;
+
 namespace libral {
   namespace target {
+  std::string base::which(const std::string& cmd) {
+    std::lock_guard<std::mutex> lock(_which_mutex);
+    auto it = _which.find(cmd);
+    if (it == _which.end()) {
+      auto paths = lookup_commands({ cmd });
+      it = _which.emplace(cmd, paths.front()).first;
+    }
+    return it->second;
+  }
+
+  void base::which_all(const std::vector<std::string>& cmds) {
+    std::lock_guard<std::mutex> lock(_which_mutex);
+    std::vector<std::string> missing;
+    for (const auto& cmd : cmds) {
+      if (_which.find(cmd) == _which.end()) {
+        missing.push_back(cmd);
+      }
+    }
+    if (missing.empty()) {
+      return;
+    }
+
+    auto paths = lookup_commands(missing);
+    for (size_t i = 0; i < missing.size(); i++) {
+      _which[missing[i]] = paths[i];
+    }
+  }
+
+  command::result
+  base::run_limited(const std::string& file,
+                    const std::vector<std::string>& args,
+                    const std::string *stdin,
+                    std::function<bool(std::string&)> out_cb,
+                    std::function<bool(std::string&)> err_cb,
+                    const limits& lim, bool own_group) {
+    static const std::string no_input;
+
+    pid_t child = 0;
+    auto pid_cb = [&lim, &child](size_t pid) {
+      child = static_cast<pid_t>(pid);
+      if (lim.cancel)
+        lim.cancel->attach(child);
+    };
+    // Detach the child however we leave, including through exceptions we
+    // do not catch here
+    struct detach_guard {
+      const limits& lim;
+      const pid_t& child;
+      ~detach_guard() {
+        if (lim.cancel && child != 0)
+          lim.cancel->detach(child);
+      }
+    } guard { lim, child };
+
+    exe::opts opts = { exe::execution_options::trim_output,
+                       exe::execution_options::merge_environment };
+    if (own_group) {
+      // The child becomes the leader of a new session and process group,
+      // so that everything it starts can be killed along with it
+      opts.set(exe::execution_options::create_detached_process);
+    }
+
+    try {
+      auto res = exe::execute(file, args, stdin ? *stdin : no_input, { },
+                              pid_cb, out_cb, err_cb, opts, lim.timeout);
+      if (! res.success && lim.cancelled()) {
+        return command::result(false, res.output,
+                               _("{1} was cancelled", file), -1);
+      }
+      return command::result(res.success, res.output, res.error,
+                             res.exit_code);
+    } catch (exe::timeout_exception& e) {
+      // leatherman only kills the child itself; take whatever it started
+      // down, too. The group outlives the child for as long as any of its
+      // members is alive, so this can not hit an unrelated process
+      if (own_group && child != 0)
+        kill(-child, SIGKILL);
+      return command::result(false, "",
+                             _("{1} was killed after running for {2} seconds",
+                               file, lim.timeout), -1);
+    }
+  }
+
   std::shared_ptr<base> make_local() {
     return std::shared_ptr<local>(new local());
   }
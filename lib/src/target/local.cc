@@ -1,4 +1,5 @@
 #include <libral/target/local.hpp>
+#include <libral/trace.hpp>
 
 #include <unistd.h>
 
@@ -33,9 +34,24 @@ namespace libral {
 
   result<std::shared_ptr<augeas::handle>>
   local::augeas(const std::vector<std::pair<std::string, std::string>>& xfms) {
-    auto aug = aug::handle::make();
-    for (auto& xfm : xfms) {
-      err_ret( aug->include(xfm.first, xfm.second) );
+    // Keep one warm augeas instance per set of transforms: its lenses
+    // stay compiled, and aug_load only reparses files that changed on
+    // disk (or whose tree we modified) since the last load.
+    //
+    // Creating and loading handles is serialized, since we do not know
+    // that augeas can do that in several threads at once
+    std::lock_guard<std::mutex> lock(_augeas_mutex);
+    auto& aug = _augeas[xfms];
+    if (! aug) {
+      auto fresh = aug::handle::make();
+      for (auto& xfm : xfms) {
+        auto r = fresh->include(xfm.first, xfm.second);
+        if (!r) {
+          _augeas.erase(xfms);
+          return r.err();
+        }
+      }
+      aug = fresh;
     }
     err_ret( aug->load() );
 
@@ -46,42 +62,50 @@ namespace libral {
     return access(file.c_str(), X_OK) == 0;
   }
 
-  std::string local::which(const std::string& cmd) {
-    return exe::which(cmd);
+  std::vector<std::string>
+  local::lookup_commands(const std::vector<std::string>& cmds) {
+    std::vector<std::string> paths;
+    for (const auto& cmd : cmds) {
+      paths.push_back(exe::which(cmd));
+    }
+    return paths;
   }
 
   result<std::string> local::upload(const std::string& cmd) {
     return cmd;
   }
 
-  static command::result as_command_result(const exe::result& res) {
-    return command::result(res.success, res.output, res.error, res.exit_code);
+  command::result local::execute(const std::string& cmd,
+                                 const std::vector<std::string>& args,
+                                 const std::string *stdin,
+                                 const limits& lim) {
+    return run_limited(cmd, args, stdin, nullptr, nullptr, lim, true);
   }
 
   command::result local::execute(const std::string& cmd,
                                  const std::vector<std::string>& args,
-                                 const std::string *stdin) {
-    if (stdin == nullptr) {
-      auto res = exe::execute(cmd, args,
-                              0, { exe::execution_options::trim_output,
-                                  exe::execution_options::merge_environment });
-      return as_command_result(res);
-    } else {
-      auto res = exe::execute(cmd, args, *stdin,
-                              0, { exe::execution_options::trim_output,
-                                  exe::execution_options::merge_environment });
-      return as_command_result(res);
-    }
+                                 const std::string& stdin,
+                                 std::function<bool(std::string&)> out_cb,
+                                 std::function<bool(std::string&)> err_cb,
+                                 const limits& lim) {
+    return run_limited(cmd, args, &stdin, out_cb, err_cb, lim, true);
+  }
+
+  result<coprocess::sptr>
+  local::spawn(const std::string& cmd, const std::vector<std::string>& args) {
+    return coprocess::spawn(cmd, args);
   }
 
   bool local::each_line(const std::string& cmd,
                         std::vector<std::string> const& args,
                         std::function<bool(std::string&)> out_cb,
-                        std::function<bool(std::string&)> err_cb) {
-    return exe::each_line(cmd, args, out_cb, err_cb);
+                        std::function<bool(std::string&)> err_cb,
+                        const limits& lim) {
+    return run_limited(cmd, args, nullptr, out_cb, err_cb, lim, true).success;
   }
 
   result<std::string> local::read(const std::string& remote_path) {
+    trace::span span("target.read", remote_path);
     std::ifstream file(remote_path);
     std::ostringstream buf;
     buf << file.rdbuf();
@@ -90,6 +114,7 @@ namespace libral {
 
   result<void> local::write(const std::string& content,
                             const std::string& remote_path) {
+    trace::span span("target.write", remote_path);
     std::ofstream file(remote_path);
     file << content;
     return result<void>();
@@ -1,10 +1,12 @@
 #include <libral/target/ssh.hpp>
+#include <libral/trace.hpp>
 
+#include <sstream>
+
+#include <boost/algorithm/string/replace.hpp>
 #include <boost/filesystem.hpp>
 
-#include <leatherman/execution/execution.hpp>
 
-namespace exe = leatherman::execution;
 namespace fs = boost::filesystem;
 namespace aug = libral::augeas;
 
@@ -113,13 +115,34 @@ namespace libral {
     }
   }
 
-  std::string ssh::which(const std::string& cmd) {
-    auto res = run_ssh({ "which", cmd });
-    if (res.success) {
-      return res.output;
-    } else {
-      return "";
+  std::vector<std::string>
+  ssh::lookup_commands(const std::vector<std::string>& cmds) {
+    // Look up all commands with one remote shell. Each answer is printed
+    // on a line of its own with a prefix, so that empty answers survive
+    // trimming of the output
+    static const std::string prefix = "ral:";
+    std::string script;
+    for (const auto& cmd : cmds) {
+      std::string quoted = cmd;
+      boost::replace_all(quoted, "'", "'\\''");
+      script += "printf '" + prefix + "%s\\n' \"$(which '" + quoted
+        + "' 2>/dev/null)\"\n";
+    }
+
+    std::vector<std::string> paths(cmds.size());
+    auto res = run_ssh({ "/bin/sh" }, &script);
+    if (! res.success) {
+      return paths;
+    }
+
+    std::istringstream out(res.output);
+    std::string line;
+    for (size_t i = 0; i < paths.size() && std::getline(out, line); i++) {
+      if (line.compare(0, prefix.size(), prefix) == 0) {
+        paths[i] = line.substr(prefix.size());
+      }
     }
+    return paths;
   }
 
   result<std::string> ssh::upload(const std::string& cmd) {
@@ -139,8 +162,9 @@ namespace libral {
   }
 
   command::result ssh::execute(const std::string& cmd,
-                                      const std::vector<std::string>& args,
-                                      const std::string *stdin) {
+                               const std::vector<std::string>& args,
+                               const std::string *stdin,
+                               const limits& lim) {
     std::vector<std::string> actual;
     actual.push_back(_target);
     if (_sudo) {
@@ -150,13 +174,43 @@ namespace libral {
     for (auto& arg : args) {
       actual.push_back(arg);
     }
-    return run("ssh", actual, stdin);
+    return run("ssh", actual, stdin, lim);
+  }
+
+  command::result ssh::execute(const std::string& cmd,
+                               const std::vector<std::string>& args,
+                               const std::string& stdin,
+                               std::function<bool(std::string&)> out_cb,
+                               std::function<bool(std::string&)> err_cb,
+                               const limits& lim) {
+    std::vector<std::string> actual = ssh_opts;
+    actual.push_back(_target);
+    if (_sudo) {
+      actual.push_back(sudo);
+    }
+    actual.push_back(cmd);
+    actual.insert(actual.end(), args.begin(), args.end());
+
+    return run_limited("ssh", actual, &stdin, out_cb, err_cb, lim, false);
+  }
+
+  result<coprocess::sptr>
+  ssh::spawn(const std::string& cmd, const std::vector<std::string>& args) {
+    std::vector<std::string> actual = ssh_opts;
+    actual.push_back(_target);
+    if (_sudo) {
+      actual.push_back(sudo);
+    }
+    actual.push_back(cmd);
+    actual.insert(actual.end(), args.begin(), args.end());
+    return coprocess::spawn("ssh", actual);
   }
 
   bool ssh::each_line(const std::string& cmd,
                       std::vector<std::string> const& args,
                       std::function<bool(std::string&)> out_cb,
-                      std::function<bool(std::string&)> err_cb) {
+                      std::function<bool(std::string&)> err_cb,
+                      const limits& lim) {
     std::vector<std::string> actual;
     actual.push_back(_target);
     if (_sudo) {
@@ -164,7 +218,8 @@ namespace libral {
     }
     actual.push_back(cmd);
     actual.insert(actual.end(), args.begin(), args.end());
-    return exe::each_line("ssh", actual, out_cb, err_cb);
+    return run_limited("ssh", actual, nullptr, out_cb, err_cb, lim,
+                       false).success;
   }
 
   command::result ssh::run_ssh(const std::vector<std::string>& args,
@@ -180,24 +235,16 @@ namespace libral {
 
   command::result ssh::run(const std::string& file,
                            const std::vector<std::string>& args,
-                           const std::string *stdin) {
+                           const std::string *stdin,
+                           const limits& lim) {
     std::vector<std::string> actual = ssh_opts;
     actual.insert(actual.end(), args.begin(), args.end());
 
-    if (stdin == nullptr) {
-      auto res = exe::execute(file, actual, 20,
-                              { exe::execution_options::trim_output,
-                                  exe::execution_options::merge_environment });
-      return command::result(res.success, res.output, res.error, res.exit_code);
-    } else {
-      auto res = exe::execute(file, actual, *stdin, 20,
-                         { exe::execution_options::trim_output,
-                             exe::execution_options::merge_environment });
-      return command::result(res.success, res.output, res.error, res.exit_code);
-    }
+    return run_limited(file, actual, stdin, nullptr, nullptr, lim, false);
   }
 
   result<std::string> ssh::read(const std::string& remote_path) {
+    trace::span span("target.read", remote_path);
     auto res = run_ssh({ "dd", "status=none", "if=" + remote_path });
     if (! res.success) {
       return error(res.output + "\n" + res.error);
@@ -208,6 +255,7 @@ namespace libral {
 
   result<void> ssh::write(const std::string& content,
                           const std::string& remote_path) {
+    trace::span span("target.write", remote_path);
     auto tmp = tmpdir();
     err_ret( tmp );
 
@@ -248,6 +296,7 @@ mv "$t" "$r"
   }
 
   result<std::string> ssh::tmpdir() {
+    std::lock_guard<std::mutex> lock(_tmpdir_mutex);
     if (_tmpdir.empty()) {
       // Do not use sudo on this, we manage the tmpdir as the normal user
       auto res = run("ssh", { _target, "mktemp", "-t", "-d", "ralXXXXXX" });
@@ -0,0 +1,135 @@
+#include <libral/trace.hpp>
+
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include <leatherman/json_container/json_container.hpp>
+
+namespace json = leatherman::json_container;
+
+namespace libral { namespace trace {
+
+  namespace impl {
+    std::atomic<bool> s_enabled(false);
+  }
+
+  // Everything below is protected by s_mutex
+  static std::mutex s_mutex;
+  static std::vector<event> s_events;
+  static std::map<std::thread::id, unsigned int> s_threads;
+
+  namespace impl {
+    void record(const char *name, std::string&& detail,
+                clock::time_point start) {
+      auto duration = clock::now() - start;
+
+      std::lock_guard<std::mutex> lock(s_mutex);
+      auto ins = s_threads.insert({ std::this_thread::get_id(),
+                                    s_threads.size() + 1 });
+      s_events.push_back({ name, std::move(detail), start, duration,
+                           ins.first->second });
+    }
+  }
+
+  void enable(bool on) {
+    impl::s_enabled.store(on);
+  }
+
+  std::vector<event> events() {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    return s_events;
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_events.clear();
+  }
+
+  static double millis(clock::duration d) {
+    return std::chrono::duration<double, std::milli>(d).count();
+  }
+
+  void write_summary(std::ostream& out) {
+    struct stats {
+      std::string name;
+      std::string detail;
+      size_t count;
+      clock::duration total;
+      clock::duration max;
+    };
+
+    std::map<std::pair<std::string, std::string>, stats> by_key;
+    for (const auto& ev : events()) {
+      auto key = std::make_pair(std::string(ev.name), ev.detail);
+      auto ins = by_key.insert({ key, { key.first, key.second, 0,
+                                        clock::duration::zero(),
+                                        clock::duration::zero() } });
+      auto& st = ins.first->second;
+      st.count += 1;
+      st.total += ev.duration;
+      st.max = std::max(st.max, ev.duration);
+    }
+
+    std::vector<stats> rows;
+    for (auto& kv : by_key) {
+      rows.push_back(std::move(kv.second));
+    }
+    std::sort(rows.begin(), rows.end(),
+              [](const stats& a, const stats& b) { return a.total > b.total; });
+
+    auto flags = out.flags();
+    auto precision = out.precision();
+
+    // Times include the time spent in nested spans
+    out << std::right << std::setw(12) << "total ms" << std::setw(8) << "count"
+        << std::setw(12) << "max ms" << "  span" << std::endl;
+    out << std::fixed << std::setprecision(3);
+    for (const auto& st : rows) {
+      out << std::setw(12) << millis(st.total) << std::setw(8) << st.count
+          << std::setw(12) << millis(st.max) << "  " << st.name;
+      if (! st.detail.empty())
+        out << " " << st.detail;
+      out << std::endl;
+    }
+    out.flags(flags);
+    out.precision(precision);
+  }
+
+  void write_chrome(std::ostream& out) {
+    using json_container = json::JsonContainer;
+    using usecs = std::chrono::duration<double, std::micro>;
+
+    auto evs = events();
+    clock::time_point origin;
+    if (! evs.empty()) {
+      origin = std::min_element(evs.begin(), evs.end(),
+                                [](const event& a, const event& b)
+                                { return a.start < b.start; })->start;
+    }
+
+    std::vector<json_container> list;
+    for (const auto& ev : evs) {
+      json_container js;
+      js.set<std::string>("name", ev.name);
+      js.set<std::string>("cat", "libral");
+      js.set<std::string>("ph", "X");
+      js.set<double>("ts", usecs(ev.start - origin).count());
+      js.set<double>("dur", usecs(ev.duration).count());
+      js.set<int>("pid", 1);
+      js.set<int>("tid", static_cast<int>(ev.thread));
+      if (! ev.detail.empty()) {
+        js.set<std::string>({ "args", "detail" }, ev.detail);
+      }
+      list.push_back(js);
+    }
+
+    json_container js;
+    js.set<std::vector<json_container>>("traceEvents", list);
+    js.set<std::string>("displayTimeUnit", "ms");
+    out << js.toString() << std::endl;
+  }
+
+} }
@@ -62,6 +62,7 @@ namespace libral {
                      const std::vector<std::string>& names,
                      const resource::attributes& config) {
     std::vector<resource> result;
+    std::set<std::string> skipped;
     struct passwd *p = NULL;
 
     setpwent();
@@ -74,15 +75,28 @@ namespace libral {
       res["home"]    = std::string(p->pw_dir);
       res["shell"]   = std::string(p->pw_shell);
       res["uid"]     = std::to_string(p->pw_uid);
-      add_group_list(res, p->pw_name, p->pw_gid);
+      if (! ctx.admits(res)) {
+        skipped.insert(res.name());
+        continue;
+      }
+      // Looking up groups means going through all of /etc/group for
+      // every user, and is by far the most expensive part of this
+      if (ctx.wants("groups"))
+        add_group_list(res, p->pw_name, p->pw_gid);
       result.push_back(std::move(res));
     }
     endpwent();
 
-    ctx.add_absent(result, names);
+    ctx.add_absent(result, names, skipped);
     return std::move(result);
   }
 
+  std::vector<std::string>
+  user_provider::watch_paths(const std::vector<std::string>& names) const {
+    // Users' secondary groups come from /etc/group
+    return { "/etc/passwd", "/etc/group" };
+  }
+
   result<void>
   user_provider::set(context &ctx, const updates& upds) {
     for (auto& u : upds) {
@@ -161,16 +175,17 @@ namespace libral {
       if (! chgs.empty()) {
         result<void> run_result;
         if (state == "present") {
-          run_result = _cmd_usermod->run(args);
+          run_result = _cmd_usermod->run(args, ctx.limits_for("set"));
         } else {
-          run_result = _cmd_useradd->run(args);
+          run_result = _cmd_useradd->run(args, ctx.limits_for("set"));
         }
         if (! run_result)
           return run_result;
       }
     } else if (ensure == "absent") {
       if (state != "absent") {
-        auto run_result = _cmd_userdel->run({ "-r", upd.name() });
+        auto run_result = _cmd_userdel->run({ "-r", upd.name() },
+                                            ctx.limits_for("set"));
         if (! run_result)
           return run_result.err();
       }
@@ -0,0 +1,271 @@
+#include <libral/watch.hpp>
+
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+
+#include <boost/filesystem.hpp>
+#include <leatherman/locale/locale.hpp>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif
+
+using namespace leatherman::locale;
+namespace fs = boost::filesystem;
+
+namespace libral {
+
+#ifdef __linux__
+
+  // The mount table is the only file in /proc we know how to watch
+  static const std::string s_mountinfo = "/proc/self/mountinfo";
+
+  // Programs that change files often do that in several steps, like
+  // writing a lock file, a temporary file and renaming it. We wait until
+  // no more events come in for this long, but at most settle_max, before
+  // we look at the providers
+  static const int settle_ms = 50;
+  static const int settle_max_ms = 500;
+
+  static const uint32_t watch_mask =
+    IN_CLOSE_WRITE | IN_MODIFY | IN_ATTRIB | IN_CREATE | IN_DELETE
+    | IN_MOVED_FROM | IN_MOVED_TO;
+
+  result<watcher::uptr> watcher::create() {
+    uptr w(new watcher());
+
+    w->_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (w->_inotify < 0) {
+      return error(_("failed to set up inotify: {1}", strerror(errno)));
+    }
+    if (pipe2(w->_wake, O_NONBLOCK | O_CLOEXEC) < 0) {
+      return error(_("failed to create a pipe: {1}", strerror(errno)));
+    }
+    return std::move(w);
+  }
+
+  watcher::~watcher() {
+    for (auto fd : { _inotify, _mountinfo, _wake[0], _wake[1] }) {
+      if (fd >= 0)
+        close(fd);
+    }
+  }
+
+  result<void> watcher::add(const std::shared_ptr<provider>& prov,
+                            const std::vector<std::string>& names,
+                            const limits& lim) {
+    auto paths = prov->watch_paths(names);
+    if (paths.empty()) {
+      return error(_("the resources of {1} can not be watched",
+                     prov->qname()));
+    }
+
+    for (const auto& path : paths) {
+      if (path == s_mountinfo) {
+        if (_mountinfo < 0) {
+          _mountinfo = open(s_mountinfo.c_str(), O_RDONLY | O_CLOEXEC);
+          if (_mountinfo < 0) {
+            return error(_("failed to open {1}: {2}", s_mountinfo,
+                           strerror(errno)));
+          }
+        }
+        continue;
+      }
+
+      // Files like /etc/passwd are usually replaced by renaming a new
+      // file over them, which a watch on the file itself would not
+      // survive. Watch the directory instead
+      auto dir = fs::path(path).parent_path().native();
+      int wd = inotify_add_watch(_inotify, dir.c_str(), watch_mask);
+      if (wd < 0) {
+        return error(_("failed to watch {1}: {2}", dir, strerror(errno)));
+      }
+      _dirs[wd] = dir;
+    }
+
+    watched w { prov, names, paths, lim, nullptr, boost::none };
+    auto res = refresh(w);
+    err_ret( res );
+    _watched.push_back(std::move(w));
+    return result<void>();
+  }
+
+  result<std::vector<snapshot::difference>> watcher::refresh(watched& w) {
+    // Get the token first: if the resources change while we get them,
+    // the token will be out of date, and we look again the next time
+    auto tok = w.prov->state_token();
+    auto rsrcs = w.prov->get(w.names, w.lim);
+    err_ret( rsrcs );
+
+    snapshot::builder bld;
+    bld.add(*w.prov, rsrcs.ok());
+    auto now = bld.build();
+
+    std::vector<snapshot::difference> deltas;
+    if (w.last) {
+      deltas = snapshot::diff(*w.last, *now);
+    }
+    w.last = std::move(now);
+    w.token = boost::none;
+    if (tok)
+      w.token = tok.ok();
+    return deltas;
+  }
+
+  void watcher::read_events(std::vector<bool>& dirty) {
+    alignas(struct inotify_event) char buf[4096];
+
+    while (true) {
+      auto len = read(_inotify, buf, sizeof(buf));
+      if (len <= 0) {
+        // EAGAIN once we have read everything
+        return;
+      }
+
+      for (char *p = buf; p < buf + len; ) {
+        auto ev = reinterpret_cast<struct inotify_event *>(p);
+        p += sizeof(struct inotify_event) + ev->len;
+
+        if (ev->mask & IN_Q_OVERFLOW) {
+          // We lost events, and have to assume that everything changed
+          dirty.assign(dirty.size(), true);
+          continue;
+        }
+
+        auto dir = _dirs.find(ev->wd);
+        if (dir == _dirs.end() || ev->len == 0) {
+          continue;
+        }
+        auto path = dir->second + "/" + ev->name;
+        for (size_t i = 0; i < _watched.size(); i++) {
+          for (const auto& wp : _watched[i].paths) {
+            if (wp == path) {
+              dirty[i] = true;
+              break;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  result<bool> watcher::wait(const callback& cb, int timeout) {
+    struct pollfd fds[3] = {
+      { _wake[0], POLLIN, 0 },
+      { _inotify, POLLIN, 0 },
+      // The kernel signals changes to the mount table with POLLPRI; a
+      // negative fd is ignored by poll
+      { _mountinfo, POLLPRI, 0 }
+    };
+
+    int n = poll(fds, 3, timeout);
+    if (n < 0) {
+      if (errno == EINTR)
+        return true;
+      return error(_("failed to wait for changes: {1}", strerror(errno)));
+    }
+    if (n == 0) {
+      return true;
+    }
+
+    if (fds[0].revents & POLLIN) {
+      char c;
+      while (read(_wake[0], &c, 1) > 0)
+        ;
+      return false;
+    }
+
+    std::vector<bool> dirty(_watched.size(), false);
+    if (fds[1].revents & POLLIN) {
+      using clock = std::chrono::steady_clock;
+      auto deadline = clock::now() + std::chrono::milliseconds(settle_max_ms);
+
+      read_events(dirty);
+      struct pollfd settle = { _inotify, POLLIN, 0 };
+      while (clock::now() < deadline && poll(&settle, 1, settle_ms) > 0) {
+        read_events(dirty);
+      }
+    }
+    if (fds[2].revents & (POLLPRI | POLLERR)) {
+      for (size_t i = 0; i < _watched.size(); i++) {
+        for (const auto& wp : _watched[i].paths) {
+          if (wp == s_mountinfo)
+            dirty[i] = true;
+        }
+      }
+    }
+
+    for (size_t i = 0; i < _watched.size(); i++) {
+      if (! dirty[i])
+        continue;
+
+      auto& w = _watched[i];
+      // Files get touched without their contents changing; providers
+      // that can tell cheaply save us a get
+      if (w.token) {
+        auto same = w.prov->unchanged_since(*w.token);
+        if (same && same.ok())
+          continue;
+      }
+
+      auto deltas = refresh(w);
+      if (deltas && deltas.ok().empty())
+        continue;
+      if (! cb(*w.prov, deltas))
+        return false;
+    }
+    return true;
+  }
+
+  result<void> watcher::run(const callback& cb) {
+    while (true) {
+      auto res = wait(cb);
+      err_ret( res );
+      if (! res.ok())
+        return result<void>();
+    }
+  }
+
+  void watcher::stop() {
+    char c = 's';
+    if (write(_wake[1], &c, 1) < 0) {
+      // The pipe is full, and wait() will stop anyway
+    }
+  }
+
+#else
+
+  result<watcher::uptr> watcher::create() {
+    return error(_("watching resources is only supported on Linux"));
+  }
+
+  watcher::~watcher() { }
+
+  result<void> watcher::add(const std::shared_ptr<provider>& prov,
+                            const std::vector<std::string>& names,
+                            const limits& lim) {
+    return error(_("watching resources is only supported on Linux"));
+  }
+
+  result<std::vector<snapshot::difference>> watcher::refresh(watched& w) {
+    return error(_("watching resources is only supported on Linux"));
+  }
+
+  void watcher::read_events(std::vector<bool>& dirty) { }
+
+  result<bool> watcher::wait(const callback& cb, int timeout) {
+    return error(_("watching resources is only supported on Linux"));
+  }
+
+  result<void> watcher::run(const callback& cb) {
+    return error(_("watching resources is only supported on Linux"));
+  }
+
+  void watcher::stop() { }
+
+#endif
+}
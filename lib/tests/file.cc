@@ -55,6 +55,27 @@ namespace libral {
         auto full_name = fs::canonical(tmp.get_file_name());
         REQUIRE(rsc.name() == full_name);
       }
+
+      SECTION("only loads the attributes the caller asks for") {
+        auto tmp = temp_file("");
+
+        auto res = prv.get({ tmp.get_file_name() }, limits(), { "mode" });
+
+        REQUIRE(res.is_ok());
+        REQUIRE(res.ok().size() == 1);
+        auto& rsc = res.ok().front();
+        REQUIRE(rsc["ensure"] == value("file"));
+        REQUIRE(rsc.lookup<std::string>("mode"));
+        REQUIRE(! rsc.lookup<std::string>("owner"));
+        REQUIRE(! rsc.lookup<std::string>("checksum"));
+      }
+
+      SECTION("rejects attributes it does not have") {
+        auto tmp = temp_file("");
+
+        auto res = prv.get({ tmp.get_file_name() }, limits(), { "colour" });
+        REQUIRE(res.is_err());
+      }
     }
 
     SECTION("update()") {
@@ -0,0 +1,165 @@
+#include <catch.hpp>
+#include <libral/ral.hpp>
+#include <libral/filter.hpp>
+
+#include "fixtures.hpp"
+
+namespace libral {
+  SCENARIO("filters for provider::get") {
+    auto aral = ral::create({ TEST_DATA_DIR });
+    auto prov = *aral->find_provider("batch");
+
+    auto rsrc = prov->create("sysadm");
+    rsrc["ensure"] = "present";
+    rsrc["uid"] = "1000";
+    rsrc["groups"] = array { "wheel", "users" };
+
+    auto parse = [](const std::vector<std::string>& exprs) {
+      auto filt = filter::parse(exprs);
+      REQUIRE(filt);
+      return filt.ok();
+    };
+
+    SECTION("parses predicates") {
+      auto pred = filter::parse_predicate("uid>=1000");
+      REQUIRE(pred);
+      REQUIRE(pred.ok().attr == "uid");
+      REQUIRE(pred.ok().oper == filter::op::ge);
+      REQUIRE(pred.ok().operand == "1000");
+      REQUIRE(pred.ok().to_string() == "uid>=1000");
+
+      auto empty = filter::parse_predicate("shell!=");
+      REQUIRE(empty);
+      REQUIRE(empty.ok().oper == filter::op::ne);
+      REQUIRE(empty.ok().operand == "");
+    }
+
+    SECTION("rejects malformed predicates") {
+      REQUIRE(! filter::parse_predicate("=present"));
+      REQUIRE(! filter::parse_predicate("ensure"));
+      REQUIRE(! filter::parse_predicate("ensure^present"));
+      REQUIRE(! filter::parse({ "uid>1", "uid" }));
+    }
+
+    SECTION("the empty filter matches everything") {
+      REQUIRE(filter().matches(rsrc));
+    }
+
+    SECTION("compares for equality") {
+      REQUIRE(parse({ "ensure=present" }).matches(rsrc));
+      REQUIRE(! parse({ "ensure=absent" }).matches(rsrc));
+      REQUIRE(parse({ "ensure!=absent" }).matches(rsrc));
+      REQUIRE(parse({ "name=sysadm" }).matches(rsrc));
+    }
+
+    SECTION("compares integers as numbers") {
+      REQUIRE(parse({ "uid>=1000" }).matches(rsrc));
+      REQUIRE(parse({ "uid>999" }).matches(rsrc));
+      REQUIRE(! parse({ "uid<200" }).matches(rsrc));
+      // Anything else is compared as strings
+      REQUIRE(parse({ "name>sys" }).matches(rsrc));
+    }
+
+    SECTION("matches globs") {
+      REQUIRE(parse({ "name~sys*" }).matches(rsrc));
+      REQUIRE(! parse({ "name~*root" }).matches(rsrc));
+    }
+
+    SECTION("matches any entry of an array") {
+      REQUIRE(parse({ "groups=wheel" }).matches(rsrc));
+      REQUIRE(! parse({ "groups=adm" }).matches(rsrc));
+      REQUIRE(parse({ "groups!=adm" }).matches(rsrc));
+      REQUIRE(! parse({ "groups!=users" }).matches(rsrc));
+    }
+
+    SECTION("requires all predicates to match") {
+      REQUIRE(parse({ "ensure=present", "uid>=1000" }).matches(rsrc));
+      REQUIRE(! parse({ "ensure=present", "uid<1000" }).matches(rsrc));
+    }
+
+    SECTION("treats missing attributes as not matching") {
+      REQUIRE(! parse({ "shell=/bin/sh" }).matches(rsrc));
+      REQUIRE(parse({ "shell!=/bin/sh" }).matches(rsrc));
+      // admits only looks at the attributes that are there
+      REQUIRE(parse({ "shell=/bin/sh" }).admits(rsrc));
+      REQUIRE(! parse({ "shell=/bin/sh", "uid<10" }).admits(rsrc));
+    }
+
+    SECTION("get rejects filters on unknown attributes") {
+      auto rsrcs = prov->get({ }, limits(), { }, parse({ "colour=red" }));
+      REQUIRE(rsrcs.is_err());
+      REQUIRE(rsrcs.err().detail == "batch::batch: unknown attribute colour");
+    }
+
+    SECTION("get only returns matching resources") {
+      auto rsrcs = prov->get({ }, limits(), { }, parse({ "name=one" }));
+      REQUIRE(rsrcs);
+      REQUIRE(rsrcs.ok().size() == 1);
+      REQUIRE(rsrcs.ok().front().name() == "one");
+    }
+  }
+
+  SCENARIO("passing filters to providers") {
+    auto aral = ral::create({ TEST_DATA_DIR });
+
+    auto parse = [](const std::vector<std::string>& exprs) {
+      auto filt = filter::parse(exprs);
+      REQUIRE(filt);
+      return filt.ok();
+    };
+
+    SECTION("rejects conditions with newlines") {
+      REQUIRE(! filter::parse_predicate("name=one\nuid<1"));
+    }
+
+    SECTION("passes all conditions to simple providers in one variable") {
+      auto prov = *aral->find_provider("filter");
+      REQUIRE(prov->spec()->filter());
+
+      // Unquoted, the shell would read '<' as a redirection and expand
+      // the glob
+      auto rsrcs = prov->get({ }, limits(), { },
+                             parse({ "uid<1000", "name~sys*" }));
+      REQUIRE(rsrcs);
+      REQUIRE(rsrcs.ok().size() == 1);
+      REQUIRE(rsrcs.ok().front().name() == "sysadm");
+      REQUIRE(rsrcs.ok().front()["received"] == value("uid<1000|name~sys*"));
+    }
+
+    SECTION("asks providers for the attributes the filter looks at") {
+      auto prov = *aral->find_provider("filter");
+
+      // Without uid, the provider's resources could not match the filter
+      auto rsrcs = prov->get({ }, limits(), { "shell" }, parse({ "uid<1000" }));
+      REQUIRE(rsrcs);
+      REQUIRE(rsrcs.ok().size() == 1);
+      auto& rsrc = rsrcs.ok().front();
+      REQUIRE(rsrc["shell"] == value("/bin/bash"));
+      // The caller did not ask for uid
+      REQUIRE(! rsrc.lookup<std::string>("uid"));
+      REQUIRE(! rsrc.lookup<std::string>("received"));
+    }
+
+    SECTION("does not report resources that do not match as absent") {
+      auto prov = *aral->find_provider("group");
+
+      // An absent root group would match this filter
+      auto rsrcs = prov->get({ "root" }, limits(), { },
+                             parse({ "gid!=0" }));
+      REQUIRE(rsrcs);
+      REQUIRE(rsrcs.ok().empty());
+
+      rsrcs = prov->get({ "root" }, limits(), { }, parse({ "gid=0" }));
+      REQUIRE(rsrcs);
+      REQUIRE(rsrcs.ok().size() == 1);
+      REQUIRE(rsrcs.ok().front()["ensure"] == value("present"));
+
+      // Resources that really do not exist still are
+      rsrcs = prov->get({ "no_such_group" }, limits(), { },
+                        parse({ "ensure=absent" }));
+      REQUIRE(rsrcs);
+      REQUIRE(rsrcs.ok().size() == 1);
+      REQUIRE(rsrcs.ok().front().name() == "no_such_group");
+    }
+  }
+}
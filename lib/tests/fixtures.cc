@@ -2,6 +2,10 @@
 #include <boost/filesystem.hpp>
 #include <leatherman/file_util/file.hpp>
 
+#include <chrono>
+#include <fstream>
+#include <thread>
+
 temp_directory::temp_directory() {
   auto unique_path = unique_fixture_path();
   dir_name = unique_path.string();
@@ -35,3 +39,18 @@ std::string const& temp_file::get_file_name() const {
 boost::filesystem::path unique_fixture_path() {
   return boost::filesystem::unique_path("file_util_fixture_%%%%-%%%%-%%%%-%%%%");
 }
+
+bool process_gone(int pid, int wait_ms) {
+  auto deadline = std::chrono::steady_clock::now()
+    + std::chrono::milliseconds(wait_ms);
+  while (true) {
+    // The third field of /proc/PID/stat is the state, Z for zombies
+    std::ifstream stat("/proc/" + std::to_string(pid) + "/stat");
+    std::string ignored, state;
+    if (! (stat >> ignored >> ignored >> state) || state == "Z")
+      return true;
+    if (std::chrono::steady_clock::now() > deadline)
+      return false;
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+}
@@ -2,6 +2,7 @@
 #include <libral/ral.hpp>
 #include <iostream>
 #include <memory>
+#include <thread>
 
 #include <boost/optional/optional_io.hpp>
 #include "boost/filesystem.hpp"
@@ -49,4 +50,60 @@ namespace libral {
     }
 
   }
+
+  SCENARIO("persistent provider harness") {
+    auto aral = ral::create({ TEST_DATA_DIR });
+    auto prov = *aral->find_provider("persistent");
+
+    // Get the resource name and return the pid of the process that
+    // answered
+    auto pid_for = [&prov](const std::string& name) {
+      auto res = prov->find(name);
+      REQUIRE(res.is_ok());
+      REQUIRE(res.ok());
+      REQUIRE(res.ok()->name() == name);
+      auto pid = res.ok()->lookup<std::string>("pid");
+      REQUIRE(pid);
+      return *pid;
+    };
+
+    SECTION("answers several requests from one process") {
+      auto all = prov->get();
+      REQUIRE(all.is_ok());
+      REQUIRE(all.ok().size() == 1);
+      auto pid = pid_for("one");
+      REQUIRE(pid_for("one") == pid);
+      REQUIRE(*all.ok().front().lookup<std::string>("pid") == pid);
+    }
+
+    SECTION("reads stderr while it waits for an answer") {
+      auto pid = pid_for("one");
+      REQUIRE(pid_for("chatty") == pid);
+      REQUIRE(pid_for("one") == pid);
+    }
+
+    SECTION("restarts the provider after it died") {
+      auto pid = pid_for("one");
+      auto res = prov->find("die");
+      REQUIRE(res.is_err());
+      REQUIRE_THAT(res.err().detail, Catch::Contains("[persistent::persistent]"));
+      REQUIRE(pid_for("one") != pid);
+    }
+
+    SECTION("restarts the provider when it answers too much") {
+      auto pid = pid_for("twice");
+      // Give the second answer time to arrive
+      std::this_thread::sleep_for(std::chrono::milliseconds(200));
+      // Without the restart, we would get the second 'twice' here
+      REQUIRE(pid_for("one") != pid);
+    }
+
+    SECTION("kills what the provider started when it is discarded") {
+      auto child = std::stoi(pid_for("linger"));
+      REQUIRE(! process_gone(child, 0));
+      prov.reset();
+      aral.reset();
+      REQUIRE(process_gone(child));
+    }
+  }
 }
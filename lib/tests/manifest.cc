@@ -0,0 +1,96 @@
+#include <catch.hpp>
+#include <libral/ral.hpp>
+#include <libral/manifest.hpp>
+
+#include "fixtures.hpp"
+
+namespace libral {
+  SCENARIO("manifests for ralsh --apply") {
+    using lanes = std::vector<std::vector<size_t>>;
+
+    auto aral = ral::create({ TEST_DATA_DIR });
+    auto provs = aral->providers();
+
+    auto parse = [&provs](const std::string& text) {
+      auto mf = manifest::parse(text, provs);
+      REQUIRE(mf);
+      return mf.ok();
+    };
+    auto parse_err = [&provs](const std::string& text) {
+      auto mf = manifest::parse(text, provs);
+      REQUIRE(! mf);
+      return mf.err().detail;
+    };
+
+    SECTION("groups resources by provider") {
+      auto mf = parse(R"json({ "resources": [
+          { "name": "one", "ral": { "type": "batch" }, "ensure": "absent" },
+          { "name": "x", "ral": { "type": "persistent" } },
+          { "name": "two", "ral": { "type": "batch", "provider": "batch::batch" } }
+        ] })json");
+
+      auto& entries = mf.entries();
+      REQUIRE(entries.size() == 2);
+      REQUIRE(entries[0].first->qname() == "batch::batch");
+      REQUIRE(entries[0].second.size() == 2);
+      REQUIRE(entries[0].second[0].name() == "one");
+      REQUIRE(entries[0].second[0]["ensure"] == value("absent"));
+      REQUIRE(entries[0].second[1].name() == "two");
+      REQUIRE(entries[1].first->type_name() == "persistent");
+      REQUIRE(entries[1].second.size() == 1);
+    }
+
+    SECTION("rejects malformed manifests") {
+      REQUIRE(parse_err("{ \"resources\": [").find("malformed manifest") == 0);
+      REQUIRE(parse_err(R"json({ "resources": [
+          { "ral": { "type": "batch" } } ] })json")
+              .find("every resource needs") == 0);
+      REQUIRE(parse_err(R"json({ "resources": [
+          { "name": "one", "ral": { } } ] })json")
+              .find("every resource needs") == 0);
+    }
+
+    SECTION("rejects unknown providers and attributes") {
+      REQUIRE(parse_err(R"json({ "resources": [
+          { "name": "one", "ral": { "type": "no_such_type" } } ] })json")
+              == "unknown provider: 'no_such_type'");
+      REQUIRE(parse_err(R"json({ "resources": [
+          { "name": "one", "ral": { "type": "batch" }, "color": "red" } ] })json")
+              == "batch::batch[one]: unknown attribute color");
+    }
+
+    SECTION("rejects resources that are listed twice") {
+      REQUIRE(parse_err(R"json({ "resources": [
+          { "name": "one", "ral": { "type": "batch" } },
+          { "name": "one", "ral": { "type": "batch" }, "ensure": "absent" }
+        ] })json") == "batch::batch[one] is listed more than once");
+    }
+
+    SECTION("runs unrelated providers in separate lanes") {
+      auto mf = parse(R"json({ "resources": [
+          { "name": "one", "ral": { "type": "batch" } },
+          { "name": "x", "ral": { "type": "persistent" } } ] })json");
+      REQUIRE(mf.lanes() == lanes({ { 0 }, { 1 } }));
+    }
+
+    SECTION("runs providers that share files one after the other") {
+      auto mf = parse(R"json({ "resources": [
+          { "name": "/etc/group", "ral": { "type": "file" } },
+          { "name": "one", "ral": { "type": "batch" } },
+          { "name": "deploy", "ral": { "type": "group" } } ] })json");
+      REQUIRE(mf.lanes() == lanes({ { 0, 2 }, { 1 } }));
+    }
+
+    SECTION("changes groups before users") {
+      REQUIRE(manifest::precedes("group", "user"));
+      REQUIRE(manifest::precedes("package", "service"));
+      REQUIRE(! manifest::precedes("user", "group"));
+
+      auto mf = parse(R"json({ "resources": [
+          { "name": "deploy", "ral": { "type": "user" } },
+          { "name": "one", "ral": { "type": "batch" } },
+          { "name": "deploy", "ral": { "type": "group" } } ] })json");
+      REQUIRE(mf.lanes() == lanes({ { 2, 0 }, { 1 } }));
+    }
+  }
+}
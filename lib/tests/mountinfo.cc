@@ -0,0 +1,48 @@
+#include <catch.hpp>
+#include <libral/mountinfo.hpp>
+
+namespace libral {
+  SCENARIO("mountinfo parser") {
+    SECTION("parses mountinfo lines") {
+      auto entries = mountinfo::parse(
+        "22 1 8:1 / / rw,relatime shared:1 - ext4 /dev/sda1 rw,errors=remount-ro\n"
+        "36 22 0:32 / /mnt/with\\040space rw,noatime shared:2 master:1 - tmpfs tmpfs rw\n"
+        "37 22 0:33 / /srv ro - nfs server:/export ro,vers=4\n");
+
+      REQUIRE(entries.size() == 3);
+
+      REQUIRE(entries[0].mountpoint == "/");
+      REQUIRE(entries[0].device == "/dev/sda1");
+      REQUIRE(entries[0].fstype == "ext4");
+      REQUIRE(entries[0].options == "rw,relatime,errors=remount-ro");
+
+      REQUIRE(entries[1].mountpoint == "/mnt/with space");
+      REQUIRE(entries[1].device == "tmpfs");
+      REQUIRE(entries[1].fstype == "tmpfs");
+      REQUIRE(entries[1].options == "rw,noatime");
+
+      REQUIRE(entries[2].mountpoint == "/srv");
+      REQUIRE(entries[2].device == "server:/export");
+      REQUIRE(entries[2].fstype == "nfs");
+      REQUIRE(entries[2].options == "ro,vers=4");
+    }
+
+    SECTION("adds the super options to the per-mount options") {
+      auto entries = mountinfo::parse(
+        "25 22 0:21 / /run rw,nosuid,nodev,relatime shared:5 - tmpfs tmpfs rw,size=1628412k,mode=755\n"
+        "26 22 0:22 / /media/cd rw,relatime - iso9660 /dev/sr0 ro,nojoliet\n");
+
+      REQUIRE(entries.size() == 2);
+      REQUIRE(entries[0].options == "rw,nosuid,nodev,relatime,size=1628412k,mode=755");
+      // A read-only filesystem makes the mount read-only, too
+      REQUIRE(entries[1].options == "ro,relatime,nojoliet");
+    }
+
+    SECTION("skips malformed lines") {
+      auto entries = mountinfo::parse("garbage\n\n"
+                                      "22 1 8:1 / / rw - ext4 /dev/sda1 rw");
+      REQUIRE(entries.size() == 1);
+      REQUIRE(entries[0].mountpoint == "/");
+    }
+  }
+}
@@ -0,0 +1,37 @@
+#include <catch.hpp>
+#include <libral/parallel.hpp>
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+namespace libral {
+  SCENARIO("running calls on a pool of threads") {
+    SECTION("makes every call exactly once") {
+      std::vector<std::atomic<int>> calls(50);
+      for (auto& c : calls) {
+        c = 0;
+      }
+
+      parallel_for(calls.size(), 4, [&calls](size_t i) { calls[i]++; });
+
+      for (auto& c : calls) {
+        REQUIRE(c == 1);
+      }
+    }
+
+    SECTION("does nothing without any calls") {
+      parallel_for(0, 0, [](size_t i) { FAIL("unexpected call"); });
+    }
+
+    SECTION("finishes all calls before rethrowing an exception") {
+      std::atomic<int> count { 0 };
+      REQUIRE_THROWS_AS(parallel_for(10, 3, [&count](size_t i) {
+            count++;
+            if (i == 2)
+              throw std::runtime_error("failed");
+          }), std::runtime_error);
+      REQUIRE(count == 10);
+    }
+  }
+}
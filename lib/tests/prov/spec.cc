@@ -0,0 +1,27 @@
+#include <catch.hpp>
+#include <libral/prov/spec.hpp>
+
+namespace libral { namespace prov {
+  SCENARIO("prov::spec::commands") {
+    SECTION("finds required and forbidden commands") {
+      auto cmds = spec::commands(R"yaml(
+provider:
+  type: package
+  invoke: simple
+  suitable:
+    commands: [yum, "not   dnf"]
+)yaml");
+      REQUIRE(cmds == std::vector<std::string>({ "yum", "dnf" }));
+    }
+
+    SECTION("ignores metadata without commands") {
+      REQUIRE(spec::commands("provider:\n  suitable: true\n").empty());
+      REQUIRE(spec::commands("provider:\n  type: host\n").empty());
+    }
+
+    SECTION("ignores malformed metadata") {
+      REQUIRE(spec::commands("- just\n- a list\n").empty());
+      REQUIRE(spec::commands("provider:\n  suitable:\n    commands: ls\n").empty());
+    }
+  }
+} }
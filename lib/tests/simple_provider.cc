@@ -0,0 +1,145 @@
+#include <catch.hpp>
+#include <libral/ral.hpp>
+#include <libral/simple_parser.hpp>
+
+#include <chrono>
+#include <fstream>
+#include <future>
+#include <thread>
+
+#include <stdlib.h>
+
+#include <boost/filesystem.hpp>
+
+#include "fixtures.hpp"
+
+namespace libral {
+  SCENARIO("simple_provider harness") {
+    auto aral = ral::create({ TEST_DATA_DIR });
+    auto batch_prov = *aral->find_provider("batch");
+
+    SECTION("finds several names in one batch") {
+      auto res = batch_prov->get({ "one", "three", "unknown" });
+      REQUIRE(res.is_ok());
+      // A full list would have produced 'two' instead of 'three'
+      REQUIRE(res.ok().size() == 2);
+      REQUIRE(res.ok()[0].name() == "one");
+      REQUIRE(res.ok()[0]["ensure"].to_string() == "present");
+      REQUIRE(res.ok()[1].name() == "three");
+      REQUIRE(res.ok()[1]["ensure"].to_string() == "absent");
+    }
+
+    SECTION("passes all updates in one batch") {
+      auto one = batch_prov->create("one");
+      one["ensure"] = "absent";
+      auto three = batch_prov->create("three");
+      three["ensure"] = "present";
+
+      auto res = batch_prov->set({ one, three });
+      REQUIRE(res.is_ok());
+      REQUIRE(res.ok().size() == 2);
+
+      for (const auto& upd_chgs : res.ok()) {
+        const auto& upd = upd_chgs.first;
+        const auto& chgs = upd_chgs.second;
+        auto was = (upd.name() == "one") ? "present" : "absent";
+        REQUIRE(chgs.size() == 1);
+        REQUIRE(chgs[0].attr == "ensure");
+        REQUIRE(chgs[0].is.to_string() == upd.should["ensure"].to_string());
+        REQUIRE(chgs[0].was.to_string() == was);
+      }
+    }
+
+    SECTION("rejects newlines in the names it passes in a batch") {
+      // Otherwise, the name would smuggle a resource of its own into the
+      // batch
+      auto res = batch_prov->get({ "one", "three\nname: two" });
+      REQUIRE(res.is_err());
+      REQUIRE(res.err().detail.find("batch::batch: name must not contain a newline") == 0);
+
+      auto evil = batch_prov->create("three\nname: two");
+      evil["ensure"] = "absent";
+      auto upd = batch_prov->set({ evil });
+      REQUIRE(upd.is_err());
+      REQUIRE(upd.err().detail.find("newline") != std::string::npos);
+    }
+  }
+
+  SCENARIO("simple_provider limits") {
+    using clock = std::chrono::steady_clock;
+    auto aral = ral::create({ TEST_DATA_DIR });
+    auto slow_prov = *aral->find_provider("slow");
+    auto start = clock::now();
+
+    // slow.prov writes the pid of the child it starts into this file
+    temp_file pidfile("");
+    auto pidpath = boost::filesystem::absolute(pidfile.get_file_name());
+    setenv("RAL_SLOW_PIDFILE", pidpath.c_str(), 1);
+    auto child_gone = [&pidpath]() {
+      std::ifstream in(pidpath.string());
+      int pid = 0;
+      REQUIRE(in >> pid);
+      return process_gone(pid);
+    };
+
+    SECTION("reads timeouts from the metadata") {
+      REQUIRE(slow_prov->spec()->timeout("list") == 1);
+      REQUIRE(slow_prov->spec()->timeout("find") == 20);
+      REQUIRE(slow_prov->spec()->timeout("update") == 20);
+    }
+
+    SECTION("kills actions that take too long") {
+      auto res = slow_prov->get();
+      REQUIRE(res.is_err());
+      REQUIRE(clock::now() - start < std::chrono::seconds(10));
+      REQUIRE(child_gone());
+    }
+
+    SECTION("lets callers override the timeout") {
+      auto res = slow_prov->find("late", limits(1));
+      REQUIRE(res.is_err());
+      REQUIRE(clock::now() - start < std::chrono::seconds(10));
+      REQUIRE(child_gone());
+    }
+
+    SECTION("stops actions when they are cancelled") {
+      auto cancel = cancellation::create();
+      auto res = std::async(std::launch::async, [&slow_prov, &cancel]() {
+          return slow_prov->find("late", limits(0, cancel));
+        });
+      // Cancel once the provider has started its child
+      while (boost::filesystem::file_size(pidpath) == 0
+             && clock::now() - start < std::chrono::seconds(5)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      }
+      cancel->cancel();
+      REQUIRE(res.get().is_err());
+      REQUIRE(clock::now() - start < std::chrono::seconds(10));
+      REQUIRE(child_gone());
+
+      // Nothing gets started once we are cancelled
+      REQUIRE(slow_prov->get({ }, limits(0, cancel)).is_err());
+    }
+  }
+
+  SCENARIO("simple_parser") {
+    using string_ref = simple_parser::string_ref;
+    string_ref key, value;
+
+    SECTION("splits lines into key and value") {
+      REQUIRE(simple_parser::split("  ensure:  present \t", key, value));
+      REQUIRE(key == "ensure");
+      REQUIRE(value == "present");
+
+      REQUIRE(simple_parser::split("message: a: b", key, value));
+      REQUIRE(key == "message");
+      REQUIRE(value == "a: b");
+
+      REQUIRE(simple_parser::split("empty:", key, value));
+      REQUIRE(key == "empty");
+      REQUIRE(value.empty());
+
+      REQUIRE(! simple_parser::split("no colon here", key, value));
+    }
+  }
+}
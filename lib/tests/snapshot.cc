@@ -0,0 +1,77 @@
+#include <catch.hpp>
+#include <libral/ral.hpp>
+#include <libral/snapshot.hpp>
+
+#include <boost/filesystem.hpp>
+#include <leatherman/file_util/file.hpp>
+
+#include "fixtures.hpp"
+
+namespace libral {
+  SCENARIO("resource snapshots") {
+    using state = snapshot::difference::state;
+
+    auto aral = ral::create({ TEST_DATA_DIR });
+    auto prov = *aral->find_provider("batch");
+
+    auto make = [&prov](const std::string& name, const std::string& ensure) {
+      auto rsrc = prov->create(name);
+      rsrc["ensure"] = ensure;
+      return rsrc;
+    };
+
+    snapshot::builder old_bld;
+    old_bld.add(*prov, { make("two", "present"), make("one", "present"),
+                         make("three", "absent") });
+
+    SECTION("finds no differences between identical snapshots") {
+      auto from = old_bld.build();
+      auto to = old_bld.build();
+      REQUIRE(from->size() == 3);
+      REQUIRE(from->providers() == std::vector<std::string>({ prov->qname() }));
+      REQUIRE(snapshot::diff(*from, *to).empty());
+    }
+
+    SECTION("reports added, removed and changed resources in order") {
+      snapshot::builder new_bld;
+      new_bld.add(*prov, { make("four", "present"), make("one", "absent"),
+                           make("three", "absent") });
+
+      auto diffs = snapshot::diff(*old_bld.build(), *new_bld.build());
+      REQUIRE(diffs.size() == 3);
+
+      REQUIRE(diffs[0].name == "four");
+      REQUIRE(diffs[0].what == state::added);
+      REQUIRE(diffs[0].provider == prov->qname());
+      REQUIRE(diffs[0].type == prov->type_name());
+
+      REQUIRE(diffs[1].name == "one");
+      REQUIRE(diffs[1].what == state::changed);
+      REQUIRE(diffs[1].chgs.size() == 1);
+      REQUIRE(diffs[1].chgs[0].attr == "ensure");
+      REQUIRE(diffs[1].chgs[0].is == value("absent"));
+      REQUIRE(diffs[1].chgs[0].was == value("present"));
+
+      REQUIRE(diffs[2].name == "two");
+      REQUIRE(diffs[2].what == state::removed);
+      REQUIRE(diffs[2].chgs[0].was == value("present"));
+    }
+
+    SECTION("reads back what it wrote") {
+      auto path = unique_fixture_path().string();
+      REQUIRE(old_bld.write(path).is_ok());
+
+      auto snap = snapshot::open(path);
+      boost::filesystem::remove(path);
+      REQUIRE(snap.is_ok());
+      REQUIRE(snap.ok()->size() == 3);
+      REQUIRE(snapshot::diff(*snap.ok(), *old_bld.build()).empty());
+    }
+
+    SECTION("rejects files that are not snapshots") {
+      temp_file tmp("this is not a snapshot, just some text");
+      auto snap = snapshot::open(tmp.get_file_name());
+      REQUIRE(snap.is_err());
+    }
+  }
+}
@@ -0,0 +1,50 @@
+#include <catch.hpp>
+#include <libral/trace.hpp>
+
+#include <sstream>
+
+namespace libral {
+  SCENARIO("tracing spans") {
+    trace::clear();
+
+    SECTION("records nothing while disabled") {
+      trace::enable(false);
+      {
+        trace::span span("test.disabled", "detail");
+      }
+      REQUIRE(trace::events().empty());
+    }
+
+    SECTION("records nested spans when they end") {
+      trace::enable();
+      {
+        trace::span outer("test.outer");
+        {
+          trace::span inner("test.inner", "some detail");
+        }
+      }
+      trace::enable(false);
+
+      auto evs = trace::events();
+      REQUIRE(evs.size() == 2);
+      REQUIRE(std::string(evs[0].name) == "test.inner");
+      REQUIRE(evs[0].detail == "some detail");
+      REQUIRE(std::string(evs[1].name) == "test.outer");
+      REQUIRE(evs[1].detail.empty());
+      REQUIRE(evs[1].start <= evs[0].start);
+      REQUIRE(evs[1].duration >= evs[0].duration);
+      REQUIRE(evs[0].thread == evs[1].thread);
+
+      std::ostringstream summary;
+      trace::write_summary(summary);
+      REQUIRE(summary.str().find("test.inner some detail") != std::string::npos);
+
+      std::ostringstream chrome;
+      trace::write_chrome(chrome);
+      REQUIRE(chrome.str().find("\"traceEvents\"") != std::string::npos);
+      REQUIRE(chrome.str().find("\"test.outer\"") != std::string::npos);
+    }
+
+    trace::clear();
+  }
+}
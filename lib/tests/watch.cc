@@ -0,0 +1,65 @@
+#include <catch.hpp>
+#include <libral/ral.hpp>
+
+#include <boost/filesystem.hpp>
+
+#include <sys/stat.h>
+
+#include "fixtures.hpp"
+
+namespace libral {
+  SCENARIO("watching resources") {
+    using deltas = result<std::vector<snapshot::difference>>;
+
+    auto aral = ral::create({ TEST_DATA_DIR });
+    auto prov = *aral->find_provider("file");
+    auto w = aral->watch();
+    REQUIRE(w.is_ok());
+    auto& watcher = *w.ok();
+
+    temp_file tmp("watched");
+    auto path = boost::filesystem::absolute(tmp.get_file_name()).native();
+    chmod(path.c_str(), 0600);
+    REQUIRE(watcher.add(prov, { path }).is_ok());
+
+    SECTION("reports the attributes that changed") {
+      chmod(path.c_str(), 0640);
+
+      std::vector<snapshot::difference> seen;
+      auto res = watcher.wait([&seen](const provider& p, const deltas& d) {
+          REQUIRE(d.is_ok());
+          seen = d.ok();
+          return true;
+        }, 5000);
+      REQUIRE(res.is_ok());
+      REQUIRE(res.ok());
+      REQUIRE(seen.size() == 1);
+      REQUIRE(seen[0].name == path);
+      REQUIRE(seen[0].what == snapshot::difference::state::changed);
+
+      bool mode_changed = false;
+      for (const auto& ch : seen[0].chgs) {
+        if (ch.attr == "mode") {
+          mode_changed = true;
+          REQUIRE(ch.is == value("0640"));
+          REQUIRE(ch.was == value("0600"));
+        }
+      }
+      REQUIRE(mode_changed);
+    }
+
+    SECTION("stops when asked to") {
+      watcher.stop();
+      auto res = watcher.wait([](const provider& p, const deltas& d) {
+          return true;
+        });
+      REQUIRE(res.is_ok());
+      REQUIRE(! res.ok());
+    }
+
+    SECTION("refuses providers that can not tell what to watch") {
+      auto batch_prov = *aral->find_provider("batch");
+      REQUIRE(watcher.add(batch_prov).is_err());
+    }
+  }
+}
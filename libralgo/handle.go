@@ -0,0 +1,253 @@
+// +build linux,cgo
+
+package libralgo
+
+/*
+#include "libral/cwrapper.hpp"
+#include <stdlib.h>
+*/
+import "C"
+
+import (
+	"errors"
+	"fmt"
+	"sync"
+	"unsafe"
+
+	"github.com/puppetlabs/libral/libralgo/types"
+)
+
+// Handle is an open instance of libral. Providers are discovered once, when
+// the Handle is opened, and are reused, together with whatever state they
+// keep, for every call made through the Handle. This makes repeated calls
+// much cheaper than the package-level functions, which start from scratch
+// every time.
+//
+// A Handle can be shared between goroutines; calls through it are
+// serialized.
+type Handle struct {
+	mu        sync.Mutex
+	ral       *C.ral_handle
+	providers map[string]*C.ral_provider
+}
+
+// Open creates a Handle that looks for providers in dataDirs in addition to
+// the default locations. The Handle must be released with Close.
+func Open(dataDirs ...string) *Handle {
+	dirs := make([]*C.char, len(dataDirs))
+	for i, dir := range dataDirs {
+		dirs[i] = C.CString(dir)
+		defer C.free(unsafe.Pointer(dirs[i]))
+	}
+
+	var dirsC **C.char
+	if len(dirs) > 0 {
+		cArray := C.malloc(C.size_t(len(dirs)) * C.size_t(unsafe.Sizeof(uintptr(0))))
+		defer C.free(cArray)
+		a := (*[1<<30 - 1]*C.char)(cArray)
+		copy(a[:len(dirs)], dirs)
+		dirsC = (**C.char)(cArray)
+	}
+
+	return &Handle{
+		ral:       C.ral_open(C.int(len(dirs)), dirsC),
+		providers: make(map[string]*C.ral_provider),
+	}
+}
+
+// Close releases the Handle and all providers looked up through it. The
+// Handle must not be used afterwards.
+func (h *Handle) Close() {
+	h.mu.Lock()
+	defer h.mu.Unlock()
+
+	for _, prov := range h.providers {
+		C.ral_provider_close(prov)
+	}
+	h.providers = nil
+	if h.ral != nil {
+		C.ral_close(h.ral)
+		h.ral = nil
+	}
+}
+
+// GetProviders returns the resource providers available to libral.
+func (h *Handle) GetProviders() ([]types.Provider, error) {
+	h.mu.Lock()
+	defer h.mu.Unlock()
+
+	if h.ral == nil {
+		return nil, fmt.Errorf("libral handle is closed")
+	}
+
+	var resultC *C.char
+	ok := C.ral_get_providers(h.ral, &resultC)
+	defer C.free_result(resultC)
+	if ok != 0 {
+		return nil, fmt.Errorf("Error thrown calling ral_get_providers: %d", ok)
+	}
+	return decodeProviders(C.GoString(resultC))
+}
+
+// GetResources returns all resources of the specified provider type.
+func (h *Handle) GetResources(typeName string) ([]types.Resource, error) {
+	h.mu.Lock()
+	defer h.mu.Unlock()
+
+	prov, err := h.provider(typeName)
+	if err != nil {
+		return nil, err
+	}
+
+	var recordsC *C.ral_records
+	C.ral_provider_get_records(prov, &recordsC, nil)
+	defer C.ral_free_records(recordsC)
+	return decodeRecords(recordsC)
+}
+
+// GetResource returns a Resource of the specified provider type with
+// matching resource name, or an empty resource if no match is found, in
+// the same way as the package-level GetResource.
+func (h *Handle) GetResource(typeName, resourceName string) (types.Resource, error) {
+	h.mu.Lock()
+	defer h.mu.Unlock()
+
+	prov, err := h.provider(typeName)
+	if err != nil {
+		return types.Resource{}, err
+	}
+	resourceNameC := C.CString(resourceName)
+	defer C.free(unsafe.Pointer(resourceNameC))
+
+	var recordsC *C.ral_records
+	C.ral_provider_get_records(prov, &recordsC, resourceNameC)
+	defer C.ral_free_records(recordsC)
+	resources, err := decodeRecords(recordsC)
+	if err != nil || len(resources) == 0 {
+		return types.Resource{}, err
+	}
+	return resources[0], nil
+}
+
+// SetResource alters the state of a resource in the same way as the
+// package-level SetResource.
+func (h *Handle) SetResource(typeName, resourceName string, desiredAttributes map[string]string) (types.Resource, error) {
+	h.mu.Lock()
+	defer h.mu.Unlock()
+
+	prov, err := h.provider(typeName)
+	if err != nil {
+		return types.Resource{}, err
+	}
+	resourceNameC := C.CString(resourceName)
+	defer C.free(unsafe.Pointer(resourceNameC))
+	desiredAttributesC, freeAttributes := cAttributes(desiredAttributes)
+	defer freeAttributes()
+
+	var recordsC *C.ral_records
+	C.ral_provider_set_records(prov, &recordsC, resourceNameC, C.int(len(desiredAttributes)), desiredAttributesC)
+	defer C.ral_free_records(recordsC)
+	resources, err := decodeRecords(recordsC)
+	if err != nil {
+		return types.Resource{}, err
+	}
+	if len(resources) != 1 {
+		return types.Resource{}, fmt.Errorf("Expected one resource from setting %s[%s], got %d", typeName, resourceName, len(resources))
+	}
+	return resources[0], nil
+}
+
+// provider returns the provider handle for typeName, looking it up only
+// the first time it is needed. The caller must hold h.mu.
+func (h *Handle) provider(typeName string) (*C.ral_provider, error) {
+	if h.ral == nil {
+		return nil, fmt.Errorf("libral handle is closed")
+	}
+	if prov, ok := h.providers[typeName]; ok {
+		return prov, nil
+	}
+
+	typeNameC := C.CString(typeName)
+	defer C.free(unsafe.Pointer(typeNameC))
+
+	prov := C.ral_find_provider(h.ral, typeNameC)
+	if prov == nil {
+		return nil, fmt.Errorf("Provider %s not found", typeName)
+	}
+	h.providers[typeName] = prov
+	return prov, nil
+}
+
+// decodeRecords turns the flat records produced by the C interface into
+// resources. Every string is copied exactly once; attribute names are
+// shared between resources.
+func decodeRecords(recordsC *C.ral_records) ([]types.Resource, error) {
+	if recordsC.error != nil {
+		return nil, errors.New(C.GoString(recordsC.error))
+	}
+
+	n := int(recordsC.count)
+	if n == 0 {
+		return nil, nil
+	}
+	records := (*[1 << 28]C.ral_record)(unsafe.Pointer(recordsC.records))[:n:n]
+
+	ral := types.RAL{
+		Type:     C.GoString(recordsC.type_name),
+		Provider: C.GoString(recordsC.provider),
+	}
+	attrNames := make(map[*C.char]string)
+	attrName := func(attrC *C.char) string {
+		name, ok := attrNames[attrC]
+		if !ok {
+			name = C.GoString(attrC)
+			attrNames[attrC] = name
+		}
+		return name
+	}
+	goString := func(s *C.char) string {
+		if s == nil {
+			return ""
+		}
+		return C.GoString(s)
+	}
+
+	var result []types.Resource
+	cur := -1
+	for _, rec := range records {
+		if rec.kind == C.RAL_RECORD_RESOURCE {
+			name := C.GoString(rec.name)
+			result = append(result, types.Resource{
+				Name:       name,
+				RAL:        ral,
+				Attributes: map[string]interface{}{"name": name},
+			})
+			cur = len(result) - 1
+			continue
+		}
+		if cur < 0 {
+			return nil, fmt.Errorf("Malformed records: attribute before resource")
+		}
+
+		attr := attrName(rec.attr)
+		attrs := result[cur].Attributes
+		switch rec.kind {
+		case C.RAL_RECORD_STRING:
+			attrs[attr] = C.GoString(rec.value)
+		case C.RAL_RECORD_BOOL:
+			attrs[attr] = C.GoString(rec.value) == "true"
+		case C.RAL_RECORD_ARRAY:
+			attrs[attr] = []interface{}{}
+		case C.RAL_RECORD_ITEM:
+			items, _ := attrs[attr].([]interface{})
+			attrs[attr] = append(items, C.GoString(rec.value))
+		case C.RAL_RECORD_CHANGE:
+			result[cur].Changes = append(result[cur].Changes, types.Change{
+				Attribute: attr,
+				Is:        goString(rec.value),
+				Was:       goString(rec.was),
+			})
+		}
+	}
+	return result, nil
+}
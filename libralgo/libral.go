@@ -25,7 +25,10 @@ func GetProviders() ([]types.Provider, error) {
 	if err != nil {
 		return nil, err
 	}
+	return decodeProviders(rawProviders)
+}
 
+func decodeProviders(rawProviders string) ([]types.Provider, error) {
 	var providersResult types.ProvidersResult
 
 	if err := json.Unmarshal([]byte(rawProviders), &providersResult); err != nil {
@@ -37,12 +40,15 @@ func GetProviders() ([]types.Provider, error) {
 
 // GetResources returns all resources of the specified provider type.
 func GetResources(typeName string) ([]types.Resource, error) {
-	var result []types.Resource
 	rawResources, err := getResourcesRaw(typeName)
 	if err != nil {
 		return nil, err
 	}
+	return decodeResources(rawResources)
+}
 
+func decodeResources(rawResources string) ([]types.Resource, error) {
+	var result []types.Resource
 	var resourcesResult types.ResourcesResult
 
 	if err := json.Unmarshal([]byte(rawResources), &resourcesResult); err != nil {
@@ -73,12 +79,15 @@ func GetResources(typeName string) ([]types.Resource, error) {
 // or an empty resource if no match is found, if more than one resource exists with the same
 // name an error is thrown.
 func GetResource(typeName, resourceName string) (types.Resource, error) {
-	var result types.Resource
 	rawResource, err := getResourceRaw(typeName, resourceName)
 	if err != nil {
 		return types.Resource{}, err
 	}
+	return decodeResource(rawResource)
+}
 
+func decodeResource(rawResource string) (types.Resource, error) {
+	var result types.Resource
 	var resourceResult types.ResourceResult
 	if err := json.Unmarshal([]byte(rawResource), &resourceResult); err != nil {
 		return types.Resource{}, fmt.Errorf("Error unmarshalling resource JSON: %v", err)
@@ -115,7 +124,10 @@ func SetResource(typeName, resourceName string, desiredAttributes map[string]str
 	if err != nil {
 		return types.Resource{}, err
 	}
+	return decodeSetResource(rawResource)
+}
 
+func decodeSetResource(rawResource string) (types.Resource, error) {
 	var setResourceResult types.SetResourceResult
 	if err := json.Unmarshal([]byte(rawResource), &setResourceResult); err != nil {
 		return types.Resource{}, fmt.Errorf("Unable to unmarshal set resource result, error: %v, JSON: %+v", err, rawResource)
@@ -189,9 +201,9 @@ func SetResource(typeName, resourceName string, desiredAttributes map[string]str
 //   }
 func getProvidersRaw() (string, error) {
 	var resultC *C.char
-	defer C.free(unsafe.Pointer(resultC))
 
 	ok := C.get_providers(&resultC)
+	defer C.free_result(resultC)
 	if ok != 0 {
 		return "", fmt.Errorf("Error thrown calling get_providers: %d", ok)
 	}
@@ -230,11 +242,11 @@ func getProvidersRaw() (string, error) {
 //   }
 func getResourcesRaw(typeName string) (string, error) {
 	var resultC *C.char
-	defer C.free(unsafe.Pointer(resultC))
 	typeNameC := C.CString(typeName)
 	defer C.free(unsafe.Pointer(typeNameC))
 
 	ok := C.get_resources(&resultC, typeNameC)
+	defer C.free_result(resultC)
 	if ok != 0 {
 		return "", fmt.Errorf("Error thrown calling get_resources: %d", ok)
 	}
@@ -263,13 +275,13 @@ func getResourcesRaw(typeName string) (string, error) {
 //   }
 func getResourceRaw(typeName, resourceName string) (string, error) {
 	var resultC *C.char
-	defer C.free(unsafe.Pointer(resultC))
 	typeNameC := C.CString(typeName)
 	defer C.free(unsafe.Pointer(typeNameC))
 	resourceNameC := C.CString(resourceName)
 	defer C.free(unsafe.Pointer(resourceNameC))
 
 	ok := C.get_resource(&resultC, typeNameC, resourceNameC)
+	defer C.free_result(resultC)
 	if ok != 0 {
 		return "", fmt.Errorf("Error thrown calling get_resource: %d", ok)
 	}
@@ -306,28 +318,40 @@ func getResourceRaw(typeName, resourceName string) (string, error) {
 // }
 func setResourceRaw(typeName, resourceName string, desiredAttributes map[string]string) (string, error) {
 	var resultC *C.char
-	defer C.free(unsafe.Pointer(resultC))
 	typeNameC := C.CString(typeName)
 	defer C.free(unsafe.Pointer(typeNameC))
 	resourceNameC := C.CString(resourceName)
 	defer C.free(unsafe.Pointer(resourceNameC))
+	desiredAttributesC, freeAttributes := cAttributes(desiredAttributes)
+	defer freeAttributes()
+
+	ok := C.set_resource(&resultC, typeNameC, resourceNameC, C.int(len(desiredAttributes)), desiredAttributesC)
+	defer C.free_result(resultC)
+	if ok != 0 {
+		return "", fmt.Errorf("Error thrown calling set_resource: %d, %s", ok, C.GoString(resultC))
+	}
+	result := C.GoString(resultC)
+	return result, nil
+}
+
+// cAttributes turns desiredAttributes into the array of 'attr=value' C
+// strings that the C interface expects; the returned function frees the
+// array and the strings in it.
+func cAttributes(desiredAttributes map[string]string) (**C.char, func()) {
 	cArray := C.malloc(C.size_t(len(desiredAttributes)) * C.size_t(unsafe.Sizeof(uintptr(0))))
-	defer C.free(unsafe.Pointer(cArray))
 
 	a := (*[1<<30 - 1]*C.char)(cArray)
 	idx := 0
 	for k, v := range desiredAttributes {
-		attrStrC := C.CString(fmt.Sprintf("%s=%s", k, v))
-		defer C.free(unsafe.Pointer(attrStrC))
-		a[idx] = attrStrC
+		a[idx] = C.CString(fmt.Sprintf("%s=%s", k, v))
 		idx++
 	}
-	desiredAttributesC := (**C.char)(cArray)
 
-	ok := C.set_resource(&resultC, typeNameC, resourceNameC, C.int(len(desiredAttributes)), desiredAttributesC)
-	if ok != 0 {
-		return "", fmt.Errorf("Error thrown calling set_resource: %d, %s", ok, C.GoString(resultC))
+	free := func() {
+		for i := 0; i < idx; i++ {
+			C.free(unsafe.Pointer(a[i]))
+		}
+		C.free(cArray)
 	}
-	result := C.GoString(resultC)
-	return result, nil
+	return (**C.char)(cArray), free
 }
@@ -145,3 +145,69 @@ func Test_GetResource(t *testing.T) {
 		})
 	}
 }
+
+func Test_HandleGetResource(t *testing.T) {
+	h := Open()
+	defer h.Close()
+
+	// Run every test twice so that the second round uses the cached
+	// provider handles
+	for round := 0; round < 2; round++ {
+		for _, test := range getResourceTests {
+			t.Run(test.title, func(t *testing.T) {
+				// The handle must behave exactly like the package-level
+				// GetResource
+				expected, expectedErr := GetResource(test.providerType, test.resourceInstance)
+				resource, err := h.GetResource(test.providerType, test.resourceInstance)
+				if (err != nil) != (expectedErr != nil) {
+					t.Fatalf("Error [%v] does not match the package-level error [%v]", err, expectedErr)
+				}
+				if err != nil {
+					t.Logf("Expected error thrown: %v", err)
+					return
+				}
+
+				if resource.Name != expected.Name {
+					t.Fatalf("Resource name [%s] does not match the package-level name [%s]", resource.Name, expected.Name)
+				}
+				if resource.Attributes[test.expectedAttr] != expected.Attributes[test.expectedAttr] {
+					t.Fatalf("Resource attribute [%s] value [%v] does not match the package-level value [%v]", test.expectedAttr, resource.Attributes[test.expectedAttr], expected.Attributes[test.expectedAttr])
+				}
+				if !test.expectError && resource.Attributes[test.expectedAttr] != test.expectedAttrValue {
+					t.Fatalf("Expected resource attribute [%s] value [%s] not found", test.expectedAttr, test.expectedAttrValue)
+				}
+			})
+		}
+	}
+}
+
+func Test_HandleGetResources(t *testing.T) {
+	h := Open()
+	defer h.Close()
+
+	for _, test := range getResourcesTests {
+		t.Run(test.title, func(t *testing.T) {
+			resources, err := h.GetResources(test.providerType)
+			if err != nil {
+				if !test.expectError {
+					t.Fatalf("Unxpected error thrown: %v", err)
+				}
+				t.Logf("Expected error thrown: %v", err)
+				return
+			}
+
+			for _, resource := range resources {
+				if resource.Name == test.expectedName {
+					if resource.Attributes[test.expectedAttr] != test.expectedAttrValue {
+						t.Fatalf("Expected resource attribute [%s] value [%s] not found", test.expectedAttr, test.expectedAttrValue)
+					}
+					if resource.RAL.Type != test.providerType {
+						t.Fatalf("Resource type [%s] does not match [%s]", resource.RAL.Type, test.providerType)
+					}
+					return
+				}
+			}
+			t.Fatalf("Expected resource [%s] not found", test.expectedName)
+		})
+	}
+}
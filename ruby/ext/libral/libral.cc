@@ -5,7 +5,12 @@
 // properly fix that.
 #undef _
 
+#include <functional>
 #include <memory>
+#include <mutex>
+
+#include <ruby/thread.h>
+
 #include <libral/ral.hpp>
 
 VALUE rb_mLibral;
@@ -17,11 +22,25 @@ namespace lib = libral;
 
 using shared_prov = std::shared_ptr<lib::provider>;
 
+// Provider calls run without the GVL. All providers of one ral share its
+// target and none of them are thread-safe, so calls through the same ral
+// are serialized with a lock that the ral and its providers share
+using shared_lock = std::shared_ptr<std::mutex>;
+
+struct ral_data {
+  std::shared_ptr<lib::ral> ral;
+  shared_lock lock;
+};
+
+struct provider_data {
+  shared_prov prov;
+  shared_lock lock;
+};
 
 // Descriptor of storing a pointer to the ral instance
 // in a RUby object
 static void free_ral(void *vral) {
-  delete (std::shared_ptr<lib::ral>*) vral;
+  delete (ral_data*) vral;
 }
 
 static const rb_data_type_t ral_data_type = {
@@ -33,7 +52,7 @@ static const rb_data_type_t ral_data_type = {
 
 
 static void free_provider(void *prov) {
-  delete (shared_prov*) prov;
+  delete (provider_data*) prov;
 }
 
 static const rb_data_type_t provider_data_type = {
@@ -43,6 +62,27 @@ static const rb_data_type_t provider_data_type = {
     RUBY_TYPED_FREE_IMMEDIATELY,
 };
 
+static void *call_function(void *fn) {
+  (*static_cast<std::function<void()>*>(fn))();
+  return nullptr;
+}
+
+/*
+ * Run fn while holding lock, but without holding Ruby's GVL so that other
+ * Ruby threads can run while a provider does slow work. fn must not touch
+ * any Ruby objects or call into Ruby.
+ */
+static void
+without_gvl(std::mutex& lock, const std::function<void()>& fn) {
+  std::function<void()> locked = [&lock, &fn]() {
+    std::lock_guard<std::mutex> guard(lock);
+    fn();
+  };
+  // We pass no unblocking function: providers run subprocesses that we
+  // can't safely interrupt, so interrupts wait until the call is done
+  rb_thread_call_without_gvl(call_function, &locked, nullptr, nullptr);
+}
+
 struct to_ruby_visitor : boost::static_visitor<VALUE> {
   result_type operator()(const boost::none_t& n) const {
     return Qnil;
@@ -117,25 +157,21 @@ resource_to_ruby(const lib::resource& res) {
 }
 
 /*
- * Retrieves the pointer to lib::type* stored in Provider objects
+ * Retrieves the provider_data stored in Provider objects
  */
-static shared_prov&
+static provider_data&
 get_provider(VALUE rb_prov) {
-  shared_prov *sp;
-  TypedData_Get_Struct(rb_prov, shared_prov, &provider_data_type, sp);
-  return *sp;
+  provider_data *pd;
+  TypedData_Get_Struct(rb_prov, provider_data, &provider_data_type, pd);
+  return *pd;
 }
 
 /*
- *  Provider#get
- *  prov_get(args) -> Array[Resource]
- *
- * +args+ can be strings or arrays of strings. It is assumed that each such
- * string is the name of a resource to get.
- * @return [Array[Resource]] a list of resources
+ * Turn the arguments to Provider#get and Provider#each into a list of
+ * resource names
  */
-VALUE
-libral_prov_get(int argc, VALUE *argv, VALUE rb_prov) {
+static std::vector<std::string>
+names_from_args(int argc, VALUE *argv) {
   std::vector<std::string> names;
 
   for (int i=0; i < argc; i++) {
@@ -151,10 +187,29 @@ libral_prov_get(int argc, VALUE *argv, VALUE rb_prov) {
                    "arguments to get must be strings or arrays of strings");
     }
   }
+  return names;
+}
 
-  shared_prov& prov = get_provider(rb_prov);
+static lib::result<std::vector<lib::resource>>
+prov_get(provider_data& pd, const std::vector<std::string>& names) {
+  lib::result<std::vector<lib::resource>> r;
+  without_gvl(*pd.lock, [&pd, &names, &r]() { r = pd.prov->get(names); });
+  return r;
+}
 
-  auto r = prov->get(names);
+/*
+ *  Provider#get
+ *  prov_get(args) -> Array[Resource]
+ *
+ * +args+ can be strings or arrays of strings. It is assumed that each such
+ * string is the name of a resource to get.
+ * @return [Array[Resource]] a list of resources
+ */
+VALUE
+libral_prov_get(int argc, VALUE *argv, VALUE rb_prov) {
+  auto names = names_from_args(argc, argv);
+
+  auto r = prov_get(get_provider(rb_prov), names);
   if (!r) {
     rb_raise(rb_eProviderError, "get failed: %s", r.err().detail.c_str());
   }
@@ -166,13 +221,71 @@ libral_prov_get(int argc, VALUE *argv, VALUE rb_prov) {
   return ary;
 }
 
+static VALUE yield_resource(VALUE vres) {
+  auto res = reinterpret_cast<const lib::resource*>(vres);
+  return rb_yield(resource_to_ruby(*res));
+}
+
+/*
+ * Yield the resources in rsrcs one at a time and return the Ruby jump state,
+ * which is not 0 if the block did not return normally. We can't let
+ * Ruby unwind through C++ code, since that skips destructors
+ */
+static int
+yield_resources(const std::vector<lib::resource>& rsrcs) {
+  int state = 0;
+  for (const auto& res : rsrcs) {
+    rb_protect(yield_resource, reinterpret_cast<VALUE>(&res), &state);
+    if (state)
+      break;
+  }
+  return state;
+}
+
+/*
+ *  Provider#each
+ *  prov_each(args) { |res| ... } -> Provider
+ *  prov_each(args) -> Enumerator
+ *
+ * Like Provider#get, but yields each resource to the block instead of
+ * building a Ruby array of all of them. This does not stream: the
+ * provider still returns all resources at once, and we only start
+ * yielding once the complete list is in memory. Breaking out of the
+ * block early therefore saves the work of converting the remaining
+ * resources to Ruby, but not of looking them up.
+ */
+VALUE
+libral_prov_each(int argc, VALUE *argv, VALUE rb_prov) {
+  RETURN_ENUMERATOR(rb_prov, argc, argv);
+
+  int state = 0;
+  VALUE err = Qnil;
+  {
+    auto names = names_from_args(argc, argv);
+    auto r = prov_get(get_provider(rb_prov), names);
+    if (!r) {
+      err = rb_str_new_cstr(r.err().detail.c_str());
+    } else {
+      state = yield_resources(r.ok());
+    }
+  }
+  if (! NIL_P(err)) {
+    rb_raise(rb_eProviderError, "get failed: %s", StringValueCStr(err));
+  }
+  if (state) {
+    rb_jump_tag(state);
+  }
+  return rb_prov;
+}
+
 /**
  * call-seq:
  *   prov_set(Array[Resource]) -> Array[Update]
  */
 VALUE
 libral_prov_set(VALUE rb_prov, VALUE rb_resource_ary) {
-  shared_prov& prov = get_provider(rb_prov);
+  provider_data& pd = get_provider(rb_prov);
+  shared_prov& prov = pd.prov;
 
   if (TYPE(rb_resource_ary) != T_ARRAY) {
     rb_raise(rb_eTypeError,
@@ -198,7 +311,8 @@ libral_prov_set(VALUE rb_prov, VALUE rb_resource_ary) {
     rsrcs.push_back(res);
   }
 
-  auto r = prov->set(rsrcs);
+  lib::result<std::vector<std::pair<lib::update, lib::changes>>> r;
+  without_gvl(*pd.lock, [&prov, &rsrcs, &r]() { r = prov->set(rsrcs); });
   if (!r) {
     rb_raise(rb_eProviderError, "%s", r.err().detail.c_str());
   }
@@ -229,25 +343,30 @@ libral_prov_set(VALUE rb_prov, VALUE rb_resource_ary) {
 }
 
 VALUE libral_prov_name(VALUE rb_prov) {
-  shared_prov& prov = get_provider(rb_prov);
+  shared_prov& prov = get_provider(rb_prov).prov;
 
   auto qname = prov->qname();
   return rb_str_new(qname.c_str(), qname.length());
 }
 
 VALUE libral_ral_provider(VALUE rb_ral, VALUE rb_name) {
-  std::shared_ptr<lib::ral> *ral;
+  ral_data *rd;
 
-  TypedData_Get_Struct(rb_ral, std::shared_ptr<lib::ral>, &ral_data_type, ral);
+  TypedData_Get_Struct(rb_ral, ral_data, &ral_data_type, rd);
 
   const char *name = StringValueCStr(rb_name);
-  auto prov = (*ral)->find_provider(name);
+  // Looking up a provider runs provider discovery
+  boost::optional<shared_prov> prov;
+  std::string lookup(name);
+  without_gvl(*rd->lock, [rd, &lookup, &prov]() {
+      prov = rd->ral->find_provider(lookup);
+    });
   if (! prov) {
     rb_raise(rb_eProviderError, "Failed to find provider '%s'", name);
   }
 
-  shared_prov* sp = new shared_prov(*prov);
-  return TypedData_Wrap_Struct(rb_cProvider, &provider_data_type, sp);
+  auto pd = new provider_data { *prov, rd->lock };
+  return TypedData_Wrap_Struct(rb_cProvider, &provider_data_type, pd);
 }
 
 /**
@@ -260,8 +379,8 @@ VALUE libral_open(VALUE libral) {
   // create returns a std::shared_ptr allocated on the stack
   auto ral_stack = lib::ral::create({ });
   // make a std::shared_ptr on the heap and remember that one
-  auto ral = new std::shared_ptr<lib::ral>(ral_stack);
-  return TypedData_Wrap_Struct(rb_cRal, &ral_data_type, ral);
+  auto rd = new ral_data { ral_stack, std::make_shared<std::mutex>() };
+  return TypedData_Wrap_Struct(rb_cRal, &ral_data_type, rd);
 }
 
 void Init_libral(void) {
@@ -287,10 +406,13 @@ void Init_libral(void) {
                    reinterpret_cast<VALUE(*)(...)>(libral_ral_provider), 1);
 
   rb_cProvider = rb_define_class_under(rb_mLibral, "Provider", rb_cObject);
+  rb_include_module(rb_cProvider, rb_mEnumerable);
   rb_define_method(rb_cProvider, "name",
                    reinterpret_cast<VALUE(*)(...)>(libral_prov_name), 0);
   rb_define_method(rb_cProvider, "set",
                    reinterpret_cast<VALUE(*)(...)>(libral_prov_set), 1);
   rb_define_method(rb_cProvider, "get",
                    reinterpret_cast<VALUE(*)(...)>(libral_prov_get), -1);
+  rb_define_method(rb_cProvider, "each",
+                   reinterpret_cast<VALUE(*)(...)>(libral_prov_each), -1);
 }
@@ -26,6 +26,11 @@ end
 #
 #   # A provider knows how to manage a certain kind of resources, such as a
 #   # user or a service.
+#   #
+#   # Provider methods release Ruby's global VM lock while the provider
+#   # does its work, so that other threads can run. Calls to providers of
+#   # the same +Libral::Ral+ are still made one at a time; use separate
+#   # +Libral.open+ connections to query in parallel.
 #   class Libral::Provider
 #     # Gets a list of resources. The returned resources will at least
 #     # contain all the resources with names +names+, but might contain more,
@@ -42,6 +47,22 @@ end
 #     # @return [Array<Resource>] list of resources
 #     def get(*names); end
 #
+#     # Yields the resources that +get+ would return one at a time. Without
+#     # a block, returns an +Enumerator+. Since +Provider+ includes
+#     # +Enumerable+, calling +each+ without +names+ makes all the usual
+#     # +Enumerable+ methods work on the provider's resources.
+#     #
+#     # This does not stream: the provider looks up all the resources
+#     # first, and +each+ starts yielding once it has the complete list.
+#     #
+#     # @example
+#     #   ral = Libral::open
+#     #   prov = ral.provider("user")
+#     #   root = prov.find { |x| x.name == "root" }
+#     #
+#     # @param names a list of resource names, as for +get+
+#     def each(*names); end
+#
 #     # Sets (enforces) the state of resources. Each resource only needs to
 #     # have the attributes specified that should actually be
 #     # changed. Attributes that are not mentioned in +resources+ are